@@ -0,0 +1,88 @@
+// Throughput of every supported TransformKernels path, world and normal matrices of many moving objects.
+// Usage: TransformKernelsBenchmark [object count] [iterations]
+
+#include <fmt/base.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <glm/gtc/quaternion.hpp>
+#include <random>
+#include <vector>
+
+#include "common/TransformKernels.h"
+
+using TransformKernels::InstructionSet;
+
+int main(const int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    const uint32_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    if (count == 0 || iterations == 0) {
+        fmt::println("usage: {} [object count] [iterations], both greater than 0", argv[0]);
+        return 1;
+    }
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution unit(-1.0f, 1.0f);
+    std::uniform_real_distribution scale(0.5f, 2.0f);
+
+    std::vector<float> components[10];
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            components[c].push_back(unit(random) * 100.0f);
+        }
+
+        const glm::quat rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+        components[3].push_back(rotation.x);
+        components[4].push_back(rotation.y);
+        components[5].push_back(rotation.z);
+        components[6].push_back(rotation.w);
+
+        for (int c = 7; c < 10; ++c) {
+            components[c].push_back(scale(random));
+        }
+    }
+
+    const TransformKernels::TransformArrays transforms{
+        components[0].data(), components[1].data(), components[2].data(), components[3].data(), components[4].data(),
+        components[5].data(), components[6].data(), components[7].data(), components[8].data(), components[9].data(),
+    };
+
+    std::vector<glm::mat4> worldMatrices(count);
+    std::vector<glm::mat4> normalMatrices(count);
+
+    fmt::println("{} objects, {} iterations", count, iterations);
+
+    double scalarTime = 0.0;
+    for (const InstructionSet instructionSet : { InstructionSet::Scalar, InstructionSet::SSE, InstructionSet::AVX2 }) {
+        const char* name = TransformKernels::getInstructionSetName(instructionSet);
+        if (instructionSet > TransformKernels::getInstructionSet()) {
+            fmt::println("{:>8}: not supported", name);
+            continue;
+        }
+
+        // Warm up the caches and the dispatch
+        TransformKernels::computeMatrices(transforms, count, worldMatrices.data(), normalMatrices.data(),
+                                          instructionSet);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            TransformKernels::computeMatrices(transforms, count, worldMatrices.data(), normalMatrices.data(),
+                                              instructionSet);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double perFrame = elapsed.count() / iterations;
+        if (instructionSet == InstructionSet::Scalar) {
+            scalarTime = perFrame;
+        }
+
+        fmt::println("{:>8}: {:8.3f} ms per batch, {:6.2f} ns per object, {:5.2f}x scalar", name, perFrame * 1e3,
+                     perFrame * 1e9 / count, scalarTime / perFrame);
+    }
+
+    // Keeps the results observable
+    volatile float sink = worldMatrices[count / 2][3][0] + normalMatrices[count / 2][0][0];
+    (void)sink;
+
+    return 0;
+}
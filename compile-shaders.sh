@@ -3,8 +3,12 @@
 set -e
 
 cd shaders
-glslc tri.vert -o vert.spv
-glslc tri.frag -o frag.spv
+glslc instanced.vert -o instanced.vert.spv
+glslc tri.frag -o tri.frag.spv
+glslc skybox.vert -o skybox.vert.spv
+glslc skybox.frag -o skybox.frag.spv
+glslc cull.comp -o cull.comp.spv
+glslc hiz.comp -o hiz.comp.spv
 cd ..
 
 echo "OK"
\ No newline at end of file
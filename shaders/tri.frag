@@ -10,10 +10,20 @@ layout (location = 4) in vec3 fragView;
 
 layout (location = 0) out vec4 outColor;
 
-const vec3 lightPos = vec3(-5.0, 0.0, 5.0);
+// Material permutation, set per pipeline. Keep in sync with SceneSpecialization
+layout (constant_id = 0) const bool hasBaseColorTexture = true;
+layout (constant_id = 1) const bool hasVertexColor = false;
+layout (constant_id = 2) const bool hasAlphaMask = false;
+layout (constant_id = 3) const float alphaCutoff = 0.5;
+
+layout (constant_id = 4) const float ambientStrength = 0.1;
+layout (constant_id = 5) const float lightPosX = -5.0;
+layout (constant_id = 6) const float lightPosY = 0.0;
+layout (constant_id = 7) const float lightPosZ = 5.0;
+
+const vec3 lightPos = vec3(lightPosX, lightPosY, lightPosZ);
 const vec3 lightColor = vec3(1.0, 1.0, 1.0);
 
-const float ambientStrength = 0.1;
 const float K = 1.0;
 
 //vec3 phong(vec3 p) {
@@ -21,15 +31,31 @@ const float K = 1.0;
 //}
 
 void main() {
+    vec4 baseColor = vec4(1.0);
+    if (hasBaseColorTexture) {
+        baseColor = texture(texSampler, fragTexCoord);
+    }
+
+    if (hasVertexColor) {
+        baseColor.rgb *= fragColor;
+    }
+
+    if (hasAlphaMask) {
+        if (baseColor.a < alphaCutoff) {
+            discard;
+        }
+
+        baseColor.a = 1.0;
+    }
+
     vec3 normal = normalize(fragNormal);
-    vec4 texColor = texture(texSampler, fragTexCoord);
     vec3 lightDir = normalize(lightPos - fragPos);
     vec4 ambient = vec4(ambientStrength * lightColor, 1.0);
     float diffuse = max(dot(normal, lightDir), 0.0);
 
-    outColor = (ambient + diffuse) * texColor;
+    outColor = (ambient + diffuse) * baseColor;
 //    outColor = ambient * texColor;
 
 //    outColor = vec4(1, 1, 1, 1);
 //    outColor *= vec4(I, I, I, 1);
-}
\ No newline at end of file
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64)
+#define BOUNDS_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Axis aligned bounding box
+struct AABB {
+    glm::vec3 min{ 0.0f };
+    glm::vec3 max{ 0.0f };
+
+    // stride is in bytes, so that positions can be read straight out of interleaved vertices
+    [[nodiscard]]
+    static AABB fromPoints(const glm::vec3* points, const size_t count, const size_t stride = sizeof(glm::vec3)) {
+        if (count == 0) {
+            return {};
+        }
+
+        const auto* bytes = reinterpret_cast<const std::byte*>(points);
+        const auto getPoint = [bytes, stride](const size_t i) -> const glm::vec3& {
+            return *reinterpret_cast<const glm::vec3*>(bytes + i * stride);
+        };
+
+        AABB box{ *points, *points };
+        size_t i = 1;
+
+#ifdef BOUNDS_USE_SSE
+        // Blocks of 4 points transposed into x, y and z vectors, each lane reduces its own points.
+        // From 16 bytes of stride a point loads as one vector, the 4th lane reading the next vertex field.
+        const auto load = [&](const size_t index) {
+            const glm::vec3& p = getPoint(index);
+            return stride >= 4 * sizeof(float) ? _mm_loadu_ps(&p.x) : _mm_setr_ps(p.x, p.y, p.z, 0.0f);
+        };
+
+        __m128 minX = _mm_set1_ps(points->x), minY = _mm_set1_ps(points->y), minZ = _mm_set1_ps(points->z);
+        __m128 maxX = minX, maxY = minY, maxZ = minZ;
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = load(i);
+            __m128 y = load(i + 1);
+            __m128 z = load(i + 2);
+            __m128 w = load(i + 3);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            minX = _mm_min_ps(minX, x);
+            minY = _mm_min_ps(minY, y);
+            minZ = _mm_min_ps(minZ, z);
+            maxX = _mm_max_ps(maxX, x);
+            maxY = _mm_max_ps(maxY, y);
+            maxZ = _mm_max_ps(maxZ, z);
+        }
+
+        // Across lanes
+        alignas(16) float lanes[6][4];
+        _mm_store_ps(lanes[0], minX);
+        _mm_store_ps(lanes[1], minY);
+        _mm_store_ps(lanes[2], minZ);
+        _mm_store_ps(lanes[3], maxX);
+        _mm_store_ps(lanes[4], maxY);
+        _mm_store_ps(lanes[5], maxZ);
+        for (int lane = 0; lane < 4; ++lane) {
+            box.min = glm::min(box.min, glm::vec3(lanes[0][lane], lanes[1][lane], lanes[2][lane]));
+            box.max = glm::max(box.max, glm::vec3(lanes[3][lane], lanes[4][lane], lanes[5][lane]));
+        }
+#endif
+
+        // Remaining points, or all of them without SSE
+        for (; i < count; ++i) {
+            box.min = glm::min(box.min, getPoint(i));
+            box.max = glm::max(box.max, getPoint(i));
+        }
+
+        return box;
+    }
+
+    [[nodiscard]]
+    glm::vec3 getCenter() const {
+        return (min + max) * 0.5f;
+    }
+
+    // Half size
+    [[nodiscard]]
+    glm::vec3 getExtents() const {
+        return (max - min) * 0.5f;
+    }
+
+    // Center (xyz) and radius (w) of the enclosing sphere
+    [[nodiscard]]
+    glm::vec4 getBoundingSphere() const {
+        return { getCenter(), glm::length(getExtents()) };
+    }
+
+    [[nodiscard]]
+    AABB merge(const AABB& other) const {
+        return { glm::min(min, other.min), glm::max(max, other.max) };
+    }
+
+    // Box enclosing the transformed box (Arvo): extents are projected on the absolute basis vectors
+    [[nodiscard]]
+    AABB transform(const glm::mat4& m) const {
+        const glm::vec3 center = glm::vec3(m * glm::vec4(getCenter(), 1.0f));
+        const glm::vec3 extents = getExtents();
+
+        glm::vec3 newExtents(0.0f);
+        for (int col = 0; col < 3; ++col) {
+            for (int row = 0; row < 3; ++row) {
+                newExtents[row] += std::fabs(m[col][row]) * extents[col];
+            }
+        }
+
+        return { center - newExtents, center + newExtents };
+    }
+};
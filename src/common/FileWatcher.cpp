@@ -0,0 +1,106 @@
+#include "FileWatcher.h"
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+#ifdef __linux__
+FileWatcher::FileWatcher(const std::string& directory) : m_directory(directory) {
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        throw std::runtime_error(fmt::format("inotify_init1 failed: {}", strerror(errno)));
+    }
+
+    // Editors often write a temporary file then rename it over the original, hence IN_MOVED_TO
+    m_watch = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (m_watch < 0) {
+        const int error = errno;
+        close(m_fd);
+        throw std::runtime_error(fmt::format("Unable to watch {}: {}", directory, strerror(error)));
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    inotify_rm_watch(m_fd, m_watch);
+    close(m_fd);
+}
+
+std::vector<std::string> FileWatcher::wait(const std::chrono::milliseconds timeout) {
+    std::vector<std::string> changed;
+
+    pollfd pollInfo{ .fd = m_fd, .events = POLLIN, .revents = 0 };
+    if (poll(&pollInfo, 1, static_cast<int>(timeout.count())) <= 0) {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        const ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;  // EAGAIN, everything was read
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                changed.push_back((m_directory / event->name).lexically_normal().string());
+            }
+
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+
+    return changed;
+}
+#else
+FileWatcher::FileWatcher(const std::string& directory) : m_directory(directory) {
+    if (!std::filesystem::is_directory(m_directory)) {
+        throw std::runtime_error(fmt::format("Unable to watch {}: not a directory", directory));
+    }
+
+    m_scan(nullptr);
+}
+
+FileWatcher::~FileWatcher() = default;
+
+std::vector<std::string> FileWatcher::wait(const std::chrono::milliseconds timeout) {
+    std::this_thread::sleep_for(timeout);
+
+    std::vector<std::string> changed;
+    m_scan(&changed);
+
+    return changed;
+}
+
+void FileWatcher::m_scan(std::vector<std::string>* changed) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(m_directory, error)) {
+        if (!entry.is_regular_file(error)) {
+            continue;
+        }
+
+        const std::string path = entry.path().lexically_normal().string();
+        const std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+
+        const auto [it, isNew] = m_writeTimes.try_emplace(path, writeTime);
+        if (!isNew && it->second == writeTime) {
+            continue;
+        }
+
+        it->second = writeTime;
+        if (changed != nullptr) {
+            changed->push_back(path);
+        }
+    }
+}
+#endif
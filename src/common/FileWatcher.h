@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files of a directory (not recursive) that were written, created or replaced.
+// Uses inotify on Linux, elsewhere it compares modification times on every wait().
+class FileWatcher {
+   public:
+    explicit FileWatcher(const std::string& directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Blocks for at most `timeout`, returns the changed paths (lexically normal, may hold duplicates)
+    std::vector<std::string> wait(std::chrono::milliseconds timeout);
+
+   private:
+    std::filesystem::path m_directory;
+
+#ifdef __linux__
+    int m_fd = -1;
+    int m_watch = -1;
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes;
+
+    void m_scan(std::vector<std::string>* changed);
+#endif
+};
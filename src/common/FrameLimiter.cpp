@@ -0,0 +1,45 @@
+#include "FrameLimiter.h"
+
+#include <thread>
+
+FrameLimiter::FrameLimiter(const double targetFps) {
+    setTargetFps(targetFps);
+}
+
+void FrameLimiter::setTargetFps(const double targetFps) {
+    m_targetFps = targetFps > 0.0 ? targetFps : 0.0;
+    m_period = m_targetFps > 0.0 ? std::chrono::duration_cast<Clock::duration>(
+                                       std::chrono::duration<double>(1.0 / m_targetFps))
+                                 : Clock::duration::zero();
+    m_deadline = Clock::now() + m_period;
+}
+
+double FrameLimiter::getTargetFps() const {
+    return m_targetFps;
+}
+
+FrameLimiter::Clock::duration FrameLimiter::wait() {
+    if (m_period == Clock::duration::zero()) {
+        return Clock::duration::zero();
+    }
+
+    const Clock::time_point start = Clock::now();
+    if (start < m_deadline - spinThreshold) {
+        std::this_thread::sleep_until(m_deadline - spinThreshold);
+    }
+
+    while (Clock::now() < m_deadline) {
+        std::this_thread::yield();
+    }
+
+    const Clock::time_point end = Clock::now();
+
+    // Deadlines are absolute to avoid drifting, unless we're more than a frame late (e.g. a hitch),
+    // in which case trying to catch up would only produce a burst of frames.
+    m_deadline += m_period;
+    if (end > m_deadline) {
+        m_deadline = end + m_period;
+    }
+
+    return end - start;
+}
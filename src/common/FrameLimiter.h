@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+
+// Paces a loop to a target rate against absolute deadlines, so that late frames don't make the loop drift.
+// Waits by sleeping most of the remaining time and spinning the last bit, as OS sleeps overshoot.
+class FrameLimiter {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameLimiter(double targetFps = 0.0);
+
+    // 0 disables the limiter
+    void setTargetFps(double targetFps);
+
+    [[nodiscard]]
+    double getTargetFps() const;
+
+    // Blocks until the next frame deadline, returns how long it waited
+    Clock::duration wait();
+
+   private:
+    // Sleep granularity is ~1ms on most platforms, anything closer than this to the deadline is spun
+    static constexpr auto spinThreshold = std::chrono::microseconds(1500);
+
+    double m_targetFps = 0.0;
+    Clock::duration m_period{};
+    Clock::time_point m_deadline;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+// Min/avg/max of a duration over a reporting window, in milliseconds
+struct TimingStat {
+    double total = 0.0;
+    double min = std::numeric_limits<double>::max();
+    double max = 0.0;
+    uint32_t count = 0;
+
+    void add(const std::chrono::steady_clock::duration duration) {
+        const double ms = std::chrono::duration<double, std::milli>(duration).count();
+        total += ms;
+        min = std::min(min, ms);
+        max = std::max(max, ms);
+        ++count;
+    }
+
+    [[nodiscard]]
+    double getAverage() const {
+        return count == 0 ? 0.0 : total / count;
+    }
+
+    [[nodiscard]]
+    double getMin() const {
+        return count == 0 ? 0.0 : min;
+    }
+
+    void reset() {
+        *this = {};
+    }
+};
+
+struct FrameStats {
+    TimingStat cpuWait;          // Time spent in the frame limiter
+    TimingStat gpuWait;          // Time blocked on frame / swap chain image fences
+    TimingStat presentInterval;  // Time between two consecutive presents
+    TimingStat cull;             // CPU frustum culling
+
+    void reset() {
+        cpuWait.reset();
+        gpuWait.reset();
+        presentInterval.reset();
+        cull.reset();
+    }
+};
@@ -0,0 +1,71 @@
+#include "FreeListAllocator.h"
+
+#include <stdexcept>
+
+FreeListAllocator::FreeListAllocator(const uint64_t capacity) : m_capacity(capacity) {
+    m_freeBlocks.emplace(0, m_capacity);
+}
+
+std::optional<uint64_t> FreeListAllocator::allocate(const uint64_t size) {
+    if (size == 0) {
+        return std::nullopt;
+    }
+
+    for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it) {
+        const auto [offset, blockSize] = *it;
+        if (blockSize < size) {
+            continue;
+        }
+
+        m_freeBlocks.erase(it);
+        if (blockSize > size) {
+            m_freeBlocks.emplace(offset + size, blockSize - size);
+        }
+
+        m_used += size;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void FreeListAllocator::free(const uint64_t offset, uint64_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    if (offset + size > m_capacity) {
+        throw std::out_of_range("FreeListAllocator: freed range is out of bounds");
+    }
+
+    m_used -= size;
+
+    uint64_t start = offset;
+    auto next = m_freeBlocks.lower_bound(offset);
+
+    // Merge with the previous block if it ends right where we start
+    if (next != m_freeBlocks.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            start = prev->first;
+            size += prev->second;
+            m_freeBlocks.erase(prev);
+        }
+    }
+
+    // Merge with the next block if it starts right where we end
+    if (next != m_freeBlocks.end() && start + size == next->first) {
+        size += next->second;
+        m_freeBlocks.erase(next);
+    }
+
+    m_freeBlocks.emplace(start, size);
+}
+
+uint64_t FreeListAllocator::getCapacity() const {
+    return m_capacity;
+}
+
+uint64_t FreeListAllocator::getUsed() const {
+    return m_used;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+// Offset/size range allocator (first-fit, adjacent free blocks are merged back together).
+// Units are up to the caller: bytes, vertices, indices...
+class FreeListAllocator {
+   public:
+    explicit FreeListAllocator(uint64_t capacity);
+
+    [[nodiscard]]
+    std::optional<uint64_t> allocate(uint64_t size);
+    void free(uint64_t offset, uint64_t size);
+
+    [[nodiscard]]
+    uint64_t getCapacity() const;
+
+    [[nodiscard]]
+    uint64_t getUsed() const;
+
+   private:
+    uint64_t m_capacity;
+    uint64_t m_used = 0;
+
+    std::map<uint64_t, uint64_t> m_freeBlocks;  // offset -> size
+};
@@ -0,0 +1,121 @@
+#include "FrustumCuller.h"
+
+#include <bit>
+
+void FrustumCuller::clear() {
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+    m_visible.clear();
+}
+
+void FrustumCuller::reserve(const size_t count) {
+    m_centerX.reserve(count);
+    m_centerY.reserve(count);
+    m_centerZ.reserve(count);
+    m_extentX.reserve(count);
+    m_extentY.reserve(count);
+    m_extentZ.reserve(count);
+    m_visible.reserve(count);
+}
+
+uint32_t FrustumCuller::add(const AABB& worldBox) {
+    const glm::vec3 center = worldBox.getCenter();
+    const glm::vec3 extents = worldBox.getExtents();
+
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_extentX.push_back(extents.x);
+    m_extentY.push_back(extents.y);
+    m_extentZ.push_back(extents.z);
+
+    return m_centerX.size() - 1;
+}
+
+const std::vector<uint32_t>& FrustumCuller::cull(const Frustum& frustum) {
+    m_visible.clear();
+
+    const size_t count = m_centerX.size();
+    size_t i = 0;
+
+#ifdef BOUNDS_USE_SSE
+    // A box is outside when it's fully behind one plane:
+    // dot(n, center) + d < -(|n.x| * extents.x + |n.y| * extents.y + |n.z| * extents.z)
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 planeX[Frustum::Count];
+    __m128 planeY[Frustum::Count];
+    __m128 planeZ[Frustum::Count];
+    __m128 planeD[Frustum::Count];
+    for (int p = 0; p < Frustum::Count; ++p) {
+        planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeD[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+        const __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+        const __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+        const __m128 extentX = _mm_loadu_ps(&m_extentX[i]);
+        const __m128 extentY = _mm_loadu_ps(&m_extentY[i]);
+        const __m128 extentZ = _mm_loadu_ps(&m_extentZ[i]);
+
+        __m128 inside = _mm_cmpeq_ps(centerX, centerX);  // All ones (bounds are never NaN)
+        for (int p = 0; p < Frustum::Count; ++p) {
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)),
+                _mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), planeD[p]));
+
+            const __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, planeX[p]), extentX),
+                           _mm_mul_ps(_mm_andnot_ps(signMask, planeY[p]), extentY)),
+                _mm_mul_ps(_mm_andnot_ps(signMask, planeZ[p]), extentZ));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(radius, signMask)));
+        }
+
+        auto mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+        while (mask != 0) {
+            m_visible.push_back(i + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // Tail, or everything without SSE
+    for (; i < count; ++i) {
+        if (m_isVisible(frustum, i)) {
+            m_visible.push_back(i);
+        }
+    }
+
+    m_stats.tested = count;
+    m_stats.visible = m_visible.size();
+
+    return m_visible;
+}
+
+const CullStats& FrustumCuller::getStats() const {
+    return m_stats;
+}
+
+bool FrustumCuller::m_isVisible(const Frustum& frustum, const size_t index) const {
+    const glm::vec3 center(m_centerX[index], m_centerY[index], m_centerZ[index]);
+    const glm::vec3 extents(m_extentX[index], m_extentY[index], m_extentZ[index]);
+
+    for (const glm::vec4& plane : frustum.planes) {
+        const glm::vec3 normal(plane);
+        const float distance = glm::dot(normal, center) + plane.w;
+        const float radius = glm::dot(glm::abs(normal), extents);
+        if (distance < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+struct CullStats {
+    uint32_t tested = 0;
+    uint32_t visible = 0;
+
+    [[nodiscard]]
+    uint32_t getCulled() const {
+        return tested - visible;
+    }
+};
+
+// Batch frustum culling of world space boxes.
+// Boxes are stored as SoA center/extents so that four of them are tested per plane with SSE.
+class FrustumCuller {
+   public:
+    void clear();
+    void reserve(size_t count);
+
+    // Returns the index used in cull results
+    uint32_t add(const AABB& worldBox);
+
+    // Indices of the visible boxes, in insertion order. Valid until the next clear()
+    const std::vector<uint32_t>& cull(const Frustum& frustum);
+
+    [[nodiscard]]
+    const CullStats& getStats() const;
+
+   private:
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_extentX;
+    std::vector<float> m_extentY;
+    std::vector<float> m_extentZ;
+
+    std::vector<uint32_t> m_visible;
+    CullStats m_stats;
+
+    [[nodiscard]]
+    bool m_isVisible(const Frustum& frustum, size_t index) const;
+};
@@ -0,0 +1,34 @@
+#include "LinearAllocator.h"
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+
+LinearAllocator::LinearAllocator(const size_t capacity)
+    : m_memory(std::make_unique<std::byte[]>(capacity)), m_capacity(capacity) {}
+
+void* LinearAllocator::allocate(const size_t size, const size_t alignment) {
+    const auto base = reinterpret_cast<uintptr_t>(m_memory.get());
+    const uintptr_t aligned = (base + m_offset + alignment - 1) & ~(alignment - 1);
+    const size_t offset = aligned - base;
+
+    if (offset + size > m_capacity) {
+        throw std::runtime_error(
+            fmt::format("linear allocator: out of memory ({} requested, {}/{} used)", size, m_offset, m_capacity));
+    }
+
+    m_offset = offset + size;
+    return m_memory.get() + offset;
+}
+
+void LinearAllocator::reset() {
+    m_offset = 0;
+}
+
+size_t LinearAllocator::getCapacity() const {
+    return m_capacity;
+}
+
+size_t LinearAllocator::getUsed() const {
+    return m_offset;
+}
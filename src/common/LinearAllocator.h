@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Bump allocator over a fixed block, everything is released at once by reset().
+// Meant for per-frame scratch data: no destructors are ever run.
+class LinearAllocator {
+   public:
+    explicit LinearAllocator(size_t capacity);
+
+    [[nodiscard]]
+    void* allocate(size_t size, size_t alignment);
+
+    template <typename T>
+    [[nodiscard]]
+    T* allocate(const size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "LinearAllocator never runs destructors");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    void reset();
+
+    [[nodiscard]]
+    size_t getCapacity() const;
+
+    [[nodiscard]]
+    size_t getUsed() const;
+
+   private:
+    std::unique_ptr<std::byte[]> m_memory;
+    size_t m_capacity;
+    size_t m_offset = 0;
+};
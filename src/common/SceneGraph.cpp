@@ -0,0 +1,192 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+
+SceneGraph::NodeID SceneGraph::addNode(const NodeID parent, const Transform& local) {
+    const NodeID node = m_slots.size();
+    const uint32_t parentSlot = parent == noParent ? noParent : m_slots.at(parent);
+
+    m_slots.push_back(m_nodes.size());
+    m_nodes.push_back(node);
+    m_positionX.push_back(local.position.x);
+    m_positionY.push_back(local.position.y);
+    m_positionZ.push_back(local.position.z);
+    m_rotationX.push_back(local.rotation.x);
+    m_rotationY.push_back(local.rotation.y);
+    m_rotationZ.push_back(local.rotation.z);
+    m_rotationW.push_back(local.rotation.w);
+    m_scaleX.push_back(local.scale.x);
+    m_scaleY.push_back(local.scale.y);
+    m_scaleZ.push_back(local.scale.z);
+    m_parents.push_back(parentSlot);
+    m_depths.push_back(parentSlot == noParent ? 0 : m_depths[parentSlot] + 1);
+    m_worldMatrices.emplace_back(1.0f);
+    m_dirty.push_back(1);
+    m_changed.push_back(0);
+
+    // The level offsets are stale even when the depth order still holds
+    m_sorted = false;
+
+    return node;
+}
+
+void SceneGraph::setLocalTransform(const NodeID node, const Transform& local) {
+    const uint32_t slot = m_slots.at(node);
+    m_positionX[slot] = local.position.x;
+    m_positionY[slot] = local.position.y;
+    m_positionZ[slot] = local.position.z;
+    m_rotationX[slot] = local.rotation.x;
+    m_rotationY[slot] = local.rotation.y;
+    m_rotationZ[slot] = local.rotation.z;
+    m_rotationW[slot] = local.rotation.w;
+    m_scaleX[slot] = local.scale.x;
+    m_scaleY[slot] = local.scale.y;
+    m_scaleZ[slot] = local.scale.z;
+    m_dirty[slot] = 1;
+}
+
+Transform SceneGraph::getLocalTransform(const NodeID node) const {
+    const uint32_t slot = m_slots.at(node);
+    return {
+        glm::vec3(m_positionX[slot], m_positionY[slot], m_positionZ[slot]),
+        glm::quat(m_rotationW[slot], m_rotationX[slot], m_rotationY[slot], m_rotationZ[slot]),
+        glm::vec3(m_scaleX[slot], m_scaleY[slot], m_scaleZ[slot]),
+    };
+}
+
+void SceneGraph::update(ThreadPool& threads) {
+    if (!m_sorted) {
+        m_sortByDepth();
+    }
+
+    // A level only reads the world matrices of the previous one
+    for (uint32_t depth = 0; depth + 1 < m_levelOffsets.size(); ++depth) {
+        m_forEachChunk(threads, m_levelOffsets[depth], m_levelOffsets[depth + 1],
+                       [this](const uint32_t begin, const uint32_t end) {
+                           for (uint32_t slot = begin; slot < end; ++slot) {
+                               const uint32_t parent = m_parents[slot];
+                               const bool parentChanged = parent != noParent && m_changed[parent];
+
+                               m_changed[slot] = m_dirty[slot] || parentChanged;
+                               m_dirty[slot] = 0;
+                           }
+
+                           // Local matrices of each run of changed nodes in one batch, then parented in place
+                           uint32_t slot = begin;
+                           while (slot < end) {
+                               if (!m_changed[slot]) {
+                                   ++slot;
+                                   continue;
+                               }
+
+                               const uint32_t runBegin = slot;
+                               while (slot < end && m_changed[slot]) {
+                                   ++slot;
+                               }
+
+                               TransformKernels::computeMatrices(m_getTransformArrays(runBegin), slot - runBegin,
+                                                                 &m_worldMatrices[runBegin], nullptr);
+                               for (uint32_t child = runBegin; child < slot; ++child) {
+                                   const uint32_t parent = m_parents[child];
+                                   if (parent != noParent) {
+                                       m_worldMatrices[child] = m_worldMatrices[parent] * m_worldMatrices[child];
+                                   }
+                               }
+                           }
+                       });
+    }
+}
+
+const glm::mat4& SceneGraph::getWorldMatrix(const NodeID node) const {
+    return m_worldMatrices[m_slots.at(node)];
+}
+
+bool SceneGraph::hasChanged(const NodeID node) const {
+    return m_changed[m_slots.at(node)];
+}
+
+uint32_t SceneGraph::size() const {
+    return m_nodes.size();
+}
+
+TransformKernels::TransformArrays SceneGraph::m_getTransformArrays(const uint32_t slot) const {
+    return {
+        .positionX = m_positionX.data() + slot,
+        .positionY = m_positionY.data() + slot,
+        .positionZ = m_positionZ.data() + slot,
+        .rotationX = m_rotationX.data() + slot,
+        .rotationY = m_rotationY.data() + slot,
+        .rotationZ = m_rotationZ.data() + slot,
+        .rotationW = m_rotationW.data() + slot,
+        .scaleX = m_scaleX.data() + slot,
+        .scaleY = m_scaleY.data() + slot,
+        .scaleZ = m_scaleZ.data() + slot,
+    };
+}
+
+void SceneGraph::m_sortByDepth() {
+    const uint32_t nodeCount = m_nodes.size();
+    const uint32_t depthCount = m_depths.empty() ? 0 : std::ranges::max(m_depths) + 1;
+
+    // Counting sort, stable: siblings keep their insertion order
+    m_levelOffsets.assign(depthCount + 1, 0);
+    for (const uint32_t depth : m_depths) {
+        ++m_levelOffsets[depth + 1];
+    }
+    for (uint32_t depth = 0; depth < depthCount; ++depth) {
+        m_levelOffsets[depth + 1] += m_levelOffsets[depth];
+    }
+
+    std::vector<uint32_t> cursors(m_levelOffsets.begin(), m_levelOffsets.end() - 1);
+    std::vector<uint32_t> newSlots(nodeCount);
+    for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+        newSlots[slot] = cursors[m_depths[slot]]++;
+    }
+
+    const auto reorder = [&]<typename T>(std::vector<T>& values) {
+        std::vector<T> sorted(values.size());
+        for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+            sorted[newSlots[slot]] = values[slot];
+        }
+        values.swap(sorted);
+    };
+
+    for (std::vector<float>* component : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY,
+                                           &m_rotationZ, &m_rotationW, &m_scaleX, &m_scaleY, &m_scaleZ }) {
+        reorder(*component);
+    }
+    reorder(m_parents);
+    reorder(m_depths);
+    reorder(m_worldMatrices);
+    reorder(m_dirty);
+    reorder(m_changed);
+    reorder(m_nodes);
+
+    for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+        if (m_parents[slot] != noParent) {
+            m_parents[slot] = newSlots[m_parents[slot]];
+        }
+        m_slots[m_nodes[slot]] = slot;
+    }
+
+    m_sorted = true;
+}
+
+void SceneGraph::m_forEachChunk(ThreadPool& threads, const uint32_t begin, const uint32_t end,
+                                const std::function<void(uint32_t begin, uint32_t end)>& job) const {
+    const uint32_t count = end - begin;
+    const uint32_t threadCount = threads.getThreadCount();
+    if (count < minParallelNodes || threadCount < 2) {
+        job(begin, end);
+        return;
+    }
+
+    const uint32_t chunkSize = (count + threadCount - 1) / threadCount;
+    threads.run([&](const uint32_t workerIndex) {
+        const uint32_t chunkBegin = begin + std::min(count, workerIndex * chunkSize);
+        const uint32_t chunkEnd = begin + std::min(count, (workerIndex + 1) * chunkSize);
+        if (chunkBegin < chunkEnd) {
+            job(chunkBegin, chunkEnd);
+        }
+    });
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Transform.h"
+#include "TransformKernels.h"
+
+// Node hierarchy, stored as structure of arrays sorted by depth: parents always come before their children,
+// so that world matrices are propagated level by level without pointer chasing. Levels large enough are
+// split across the threads of a ThreadPool.
+class SceneGraph {
+   public:
+    typedef uint32_t NodeID;
+    static constexpr NodeID noParent = std::numeric_limits<NodeID>::max();
+
+    // IDs stay valid when nodes are reordered. `parent` must have been added before.
+    NodeID addNode(NodeID parent, const Transform& local);
+
+    void setLocalTransform(NodeID node, const Transform& local);
+
+    [[nodiscard]]
+    Transform getLocalTransform(NodeID node) const;
+
+    // Recomputes the world matrices of the nodes changed since the last update, and their descendants
+    void update(ThreadPool& threads);
+
+    [[nodiscard]]
+    const glm::mat4& getWorldMatrix(NodeID node) const;
+
+    // The world matrix changed in the last update
+    [[nodiscard]]
+    bool hasChanged(NodeID node) const;
+
+    [[nodiscard]]
+    uint32_t size() const;
+
+   private:
+    // Below this, a level is cheaper to propagate on the calling thread
+    static constexpr uint32_t minParallelNodes = 4096;
+
+    // Local transforms from `slot` onwards, as kernel inputs
+    [[nodiscard]]
+    TransformKernels::TransformArrays m_getTransformArrays(uint32_t slot) const;
+
+    void m_sortByDepth();
+    void m_forEachChunk(ThreadPool& threads, uint32_t begin, uint32_t end,
+                        const std::function<void(uint32_t begin, uint32_t end)>& job) const;
+
+    // Per slot, in depth order once sorted. Local transforms are split by component for the batch kernels.
+    std::vector<float> m_positionX, m_positionY, m_positionZ;
+    std::vector<float> m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+    std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+    std::vector<uint32_t> m_parents;  // Slot of the parent, noParent for roots
+    std::vector<uint32_t> m_depths;
+    std::vector<glm::mat4> m_worldMatrices;
+    // uint8_t rather than bool: written concurrently by slot, vector<bool> packs them into shared words
+    std::vector<uint8_t> m_dirty;    // Local transform changed since the last update
+    std::vector<uint8_t> m_changed;  // World matrix changed in the last update
+    std::vector<NodeID> m_nodes;     // Slot to ID
+
+    std::vector<uint32_t> m_slots;  // ID to slot
+
+    // Depth d spans the slots [m_levelOffsets[d], m_levelOffsets[d + 1])
+    std::vector<uint32_t> m_levelOffsets;
+    bool m_sorted = true;
+};
@@ -8,22 +8,27 @@ class Thing {
 
     virtual void translate(const glm::vec3& v) {
         m_transform.position += v;
+        m_matricesDirty = true;
     }
 
     virtual void localTranslate(const glm::vec3& v) {
         m_transform.position += m_transform.rotation * v;
+        m_matricesDirty = true;
     }
 
     virtual void rotate(const float angle, const glm::vec3& v) {
         m_transform.rotate(angle, v);
+        m_matricesDirty = true;
     }
 
     virtual void scale(const glm::vec3& v) {
         m_transform.scale += v;
+        m_matricesDirty = true;
     }
 
     virtual void setPosition(const glm::vec3& v) {
         m_transform.position = v;
+        m_matricesDirty = true;
     }
 
     [[nodiscard]]
@@ -31,6 +36,35 @@ class Thing {
         return m_transform;
     }
 
+    // Cached, only recomputed after the transform changed. Not thread safe: the first call after a change writes.
+    [[nodiscard]]
+    const glm::mat4& getWorldMatrix() const {
+        m_updateMatrices();
+        return m_worldMatrix;
+    }
+
+    [[nodiscard]]
+    const glm::mat4& getNormalMatrix() const {
+        m_updateMatrices();
+        return m_normalMatrix;
+    }
+
    protected:
+    // Written through the setters above only, they keep the cached matrices in sync
     Transform m_transform;
-};
\ No newline at end of file
+
+   private:
+    void m_updateMatrices() const {
+        if (!m_matricesDirty) {
+            return;
+        }
+
+        m_worldMatrix = m_transform.getMatrix();
+        m_normalMatrix = Transform::getNormalMatrix(m_worldMatrix);
+        m_matricesDirty = false;
+    }
+
+    mutable glm::mat4 m_worldMatrix{ 1.0f };
+    mutable glm::mat4 m_normalMatrix{ 1.0f };
+    mutable bool m_matricesDirty = true;
+};
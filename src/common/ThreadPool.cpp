@@ -0,0 +1,79 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&ThreadPool::m_workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_jobReady.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(const std::function<void(uint32_t)>& job) {
+    std::unique_lock lock(m_mutex);
+    m_job = &job;
+    m_pending = m_threads.size();
+    m_error = nullptr;
+    ++m_generation;
+
+    m_jobReady.notify_all();
+    m_jobDone.wait(lock, [this] { return m_pending == 0; });
+    m_job = nullptr;
+
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+uint32_t ThreadPool::getThreadCount() const {
+    return m_threads.size();
+}
+
+void ThreadPool::m_workerLoop(const uint32_t workerIndex) {
+    uint64_t lastGeneration = 0;
+
+    while (true) {
+        const std::function<void(uint32_t)>* job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_jobReady.wait(lock, [&] { return m_stopping || m_generation != lastGeneration; });
+            if (m_stopping) {
+                return;
+            }
+
+            lastGeneration = m_generation;
+            job = m_job;
+        }
+
+        try {
+            (*job)(workerIndex);
+        } catch (...) {
+            std::lock_guard lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            --m_pending;
+        }
+        m_jobDone.notify_one();
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for fork/join style work: run() hands the same job to every worker
+// (each receiving its own index) and returns once they are all done.
+class ThreadPool {
+   public:
+    // 0 picks the hardware concurrency
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Rethrows the first exception thrown by a worker
+    void run(const std::function<void(uint32_t workerIndex)>& job);
+
+    [[nodiscard]]
+    uint32_t getThreadCount() const;
+
+   private:
+    void m_workerLoop(uint32_t workerIndex);
+
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_jobDone;
+
+    const std::function<void(uint32_t)>* m_job = nullptr;
+    uint64_t m_generation = 0;
+    uint32_t m_pending = 0;
+    std::exception_ptr m_error;
+    bool m_stopping = false;
+};
@@ -11,7 +11,6 @@ struct Transform {
 
     [[nodiscard]]
     glm::mat4 getMatrix() const {
-        // TODO: make model matrix member
         const glm::mat4 translationMatrix = translate(glm::mat4(1.0f), position);
         const glm::mat4 rotationMatrix = mat4_cast(rotation);
         const glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
@@ -0,0 +1,278 @@
+#include "TransformKernels.h"
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+
+#include "Transform.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TRANSFORM_KERNELS_X86
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+// Only the AVX2 functions are compiled for AVX2, they are called once it's known to be supported
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace TransformKernels {
+namespace {
+InstructionSet detectInstructionSet() {
+#ifndef TRANSFORM_KERNELS_X86
+    return InstructionSet::Scalar;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    // SSE2 is part of x86-64. AVX2 also needs the OS to save the ymm registers.
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return InstructionSet::SSE;
+    }
+
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+
+    return osSavesYmm && (info[1] & (1 << 5)) ? InstructionSet::AVX2 : InstructionSet::SSE;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? InstructionSet::AVX2 : InstructionSet::SSE;
+#endif
+}
+
+#ifdef TRANSFORM_KERNELS_X86
+// The tail of a SIMD pass, starting at `first`
+TransformArrays offset(const TransformArrays& t, const size_t first) {
+    return {
+        t.positionX + first, t.positionY + first, t.positionZ + first, t.rotationX + first, t.rotationY + first,
+        t.rotationZ + first, t.rotationW + first, t.scaleX + first,    t.scaleY + first,    t.scaleZ + first,
+    };
+}
+
+// Writes column `column` of 4 matrices, from one register per component
+void storeColumn4(glm::mat4* matrices, const int column, __m128 x, __m128 y, __m128 z, __m128 w) {
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&matrices[0][column].x, x);
+    _mm_storeu_ps(&matrices[1][column].x, y);
+    _mm_storeu_ps(&matrices[2][column].x, z);
+    _mm_storeu_ps(&matrices[3][column].x, w);
+}
+
+void computeMatricesSse(const TransformArrays& t, const size_t count, glm::mat4* worldMatrices,
+                        glm::mat4* normalMatrices) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(t.rotationX + i);
+        const __m128 y = _mm_loadu_ps(t.rotationY + i);
+        const __m128 z = _mm_loadu_ps(t.rotationZ + i);
+        const __m128 w = _mm_loadu_ps(t.rotationW + i);
+
+        // Rotation matrix, as glm::mat3_cast
+        const __m128 x2 = _mm_add_ps(x, x);
+        const __m128 y2 = _mm_add_ps(y, y);
+        const __m128 z2 = _mm_add_ps(z, z);
+        const __m128 xx = _mm_mul_ps(x, x2);
+        const __m128 yy = _mm_mul_ps(y, y2);
+        const __m128 zz = _mm_mul_ps(z, z2);
+        const __m128 xy = _mm_mul_ps(x, y2);
+        const __m128 xz = _mm_mul_ps(x, z2);
+        const __m128 yz = _mm_mul_ps(y, z2);
+        const __m128 wx = _mm_mul_ps(w, x2);
+        const __m128 wy = _mm_mul_ps(w, y2);
+        const __m128 wz = _mm_mul_ps(w, z2);
+
+        const __m128 r00 = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+        const __m128 r01 = _mm_add_ps(xy, wz);
+        const __m128 r02 = _mm_sub_ps(xz, wy);
+        const __m128 r10 = _mm_sub_ps(xy, wz);
+        const __m128 r11 = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+        const __m128 r12 = _mm_add_ps(yz, wx);
+        const __m128 r20 = _mm_add_ps(xz, wy);
+        const __m128 r21 = _mm_sub_ps(yz, wx);
+        const __m128 r22 = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+        const __m128 sx = _mm_loadu_ps(t.scaleX + i);
+        const __m128 sy = _mm_loadu_ps(t.scaleY + i);
+        const __m128 sz = _mm_loadu_ps(t.scaleZ + i);
+
+        glm::mat4* world = worldMatrices + i;
+        storeColumn4(world, 0, _mm_mul_ps(r00, sx), _mm_mul_ps(r01, sx), _mm_mul_ps(r02, sx), zero);
+        storeColumn4(world, 1, _mm_mul_ps(r10, sy), _mm_mul_ps(r11, sy), _mm_mul_ps(r12, sy), zero);
+        storeColumn4(world, 2, _mm_mul_ps(r20, sz), _mm_mul_ps(r21, sz), _mm_mul_ps(r22, sz), zero);
+        storeColumn4(world, 3, _mm_loadu_ps(t.positionX + i), _mm_loadu_ps(t.positionY + i),
+                     _mm_loadu_ps(t.positionZ + i), one);
+
+        if (normalMatrices != nullptr) {
+            const __m128 isx = _mm_div_ps(one, sx);
+            const __m128 isy = _mm_div_ps(one, sy);
+            const __m128 isz = _mm_div_ps(one, sz);
+
+            glm::mat4* normal = normalMatrices + i;
+            storeColumn4(normal, 0, _mm_mul_ps(r00, isx), _mm_mul_ps(r01, isx), _mm_mul_ps(r02, isx), zero);
+            storeColumn4(normal, 1, _mm_mul_ps(r10, isy), _mm_mul_ps(r11, isy), _mm_mul_ps(r12, isy), zero);
+            storeColumn4(normal, 2, _mm_mul_ps(r20, isz), _mm_mul_ps(r21, isz), _mm_mul_ps(r22, isz), zero);
+            storeColumn4(normal, 3, zero, zero, zero, one);
+        }
+    }
+
+    computeMatricesScalar(offset(t, i), count - i, worldMatrices + i,
+                          normalMatrices != nullptr ? normalMatrices + i : nullptr);
+}
+
+// Writes column `column` of 8 matrices. After the in-lane transpose, the low half of each register
+// holds the column of matrix n and the high half the one of matrix n + 4.
+TARGET_AVX2 void storeColumn8(glm::mat4* matrices, const int column, const __m256 x, const __m256 y, const __m256 z,
+                              const __m256 w) {
+    const __m256 xy0 = _mm256_unpacklo_ps(x, y);
+    const __m256 xy1 = _mm256_unpackhi_ps(x, y);
+    const __m256 zw0 = _mm256_unpacklo_ps(z, w);
+    const __m256 zw1 = _mm256_unpackhi_ps(z, w);
+
+    const __m256 columns[4] = {
+        _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2)),
+    };
+
+    for (int n = 0; n < 4; ++n) {
+        _mm_storeu_ps(&matrices[n][column].x, _mm256_castps256_ps128(columns[n]));
+        _mm_storeu_ps(&matrices[n + 4][column].x, _mm256_extractf128_ps(columns[n], 1));
+    }
+}
+
+TARGET_AVX2 void computeMatricesAvx2(const TransformArrays& t, const size_t count, glm::mat4* worldMatrices,
+                                     glm::mat4* normalMatrices) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(t.rotationX + i);
+        const __m256 y = _mm256_loadu_ps(t.rotationY + i);
+        const __m256 z = _mm256_loadu_ps(t.rotationZ + i);
+        const __m256 w = _mm256_loadu_ps(t.rotationW + i);
+
+        // Rotation matrix, as glm::mat3_cast
+        const __m256 x2 = _mm256_add_ps(x, x);
+        const __m256 y2 = _mm256_add_ps(y, y);
+        const __m256 z2 = _mm256_add_ps(z, z);
+        const __m256 xx = _mm256_mul_ps(x, x2);
+        const __m256 yy = _mm256_mul_ps(y, y2);
+        const __m256 zz = _mm256_mul_ps(z, z2);
+        const __m256 xy = _mm256_mul_ps(x, y2);
+        const __m256 xz = _mm256_mul_ps(x, z2);
+        const __m256 yz = _mm256_mul_ps(y, z2);
+        const __m256 wx = _mm256_mul_ps(w, x2);
+        const __m256 wy = _mm256_mul_ps(w, y2);
+        const __m256 wz = _mm256_mul_ps(w, z2);
+
+        const __m256 r00 = _mm256_sub_ps(one, _mm256_add_ps(yy, zz));
+        const __m256 r01 = _mm256_add_ps(xy, wz);
+        const __m256 r02 = _mm256_sub_ps(xz, wy);
+        const __m256 r10 = _mm256_sub_ps(xy, wz);
+        const __m256 r11 = _mm256_sub_ps(one, _mm256_add_ps(xx, zz));
+        const __m256 r12 = _mm256_add_ps(yz, wx);
+        const __m256 r20 = _mm256_add_ps(xz, wy);
+        const __m256 r21 = _mm256_sub_ps(yz, wx);
+        const __m256 r22 = _mm256_sub_ps(one, _mm256_add_ps(xx, yy));
+
+        const __m256 sx = _mm256_loadu_ps(t.scaleX + i);
+        const __m256 sy = _mm256_loadu_ps(t.scaleY + i);
+        const __m256 sz = _mm256_loadu_ps(t.scaleZ + i);
+
+        glm::mat4* world = worldMatrices + i;
+        storeColumn8(world, 0, _mm256_mul_ps(r00, sx), _mm256_mul_ps(r01, sx), _mm256_mul_ps(r02, sx), zero);
+        storeColumn8(world, 1, _mm256_mul_ps(r10, sy), _mm256_mul_ps(r11, sy), _mm256_mul_ps(r12, sy), zero);
+        storeColumn8(world, 2, _mm256_mul_ps(r20, sz), _mm256_mul_ps(r21, sz), _mm256_mul_ps(r22, sz), zero);
+        storeColumn8(world, 3, _mm256_loadu_ps(t.positionX + i), _mm256_loadu_ps(t.positionY + i),
+                     _mm256_loadu_ps(t.positionZ + i), one);
+
+        if (normalMatrices != nullptr) {
+            const __m256 isx = _mm256_div_ps(one, sx);
+            const __m256 isy = _mm256_div_ps(one, sy);
+            const __m256 isz = _mm256_div_ps(one, sz);
+
+            glm::mat4* normal = normalMatrices + i;
+            storeColumn8(normal, 0, _mm256_mul_ps(r00, isx), _mm256_mul_ps(r01, isx), _mm256_mul_ps(r02, isx), zero);
+            storeColumn8(normal, 1, _mm256_mul_ps(r10, isy), _mm256_mul_ps(r11, isy), _mm256_mul_ps(r12, isy), zero);
+            storeColumn8(normal, 2, _mm256_mul_ps(r20, isz), _mm256_mul_ps(r21, isz), _mm256_mul_ps(r22, isz), zero);
+            storeColumn8(normal, 3, zero, zero, zero, one);
+        }
+    }
+
+    // At most 7 left, a 4 wide pass halves the scalar tail
+    computeMatricesSse(offset(t, i), count - i, worldMatrices + i,
+                       normalMatrices != nullptr ? normalMatrices + i : nullptr);
+}
+#endif
+}  // namespace
+
+InstructionSet getInstructionSet() {
+    static const InstructionSet instructionSet = detectInstructionSet();
+    return instructionSet;
+}
+
+const char* getInstructionSetName(const InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case InstructionSet::AVX2:
+            return "AVX2";
+        case InstructionSet::SSE:
+            return "SSE";
+        case InstructionSet::Scalar:
+            break;
+    }
+
+    return "scalar";
+}
+
+void computeMatrices(const TransformArrays& transforms, const size_t count, glm::mat4* worldMatrices,
+                     glm::mat4* normalMatrices) {
+    computeMatrices(transforms, count, worldMatrices, normalMatrices, getInstructionSet());
+}
+
+void computeMatrices(const TransformArrays& transforms, const size_t count, glm::mat4* worldMatrices,
+                     glm::mat4* normalMatrices, const InstructionSet instructionSet) {
+    if (instructionSet > getInstructionSet()) {
+        throw std::invalid_argument(
+            fmt::format("transform kernels: {} is not supported", getInstructionSetName(instructionSet)));
+    }
+
+#ifdef TRANSFORM_KERNELS_X86
+    switch (instructionSet) {
+        case InstructionSet::AVX2:
+            computeMatricesAvx2(transforms, count, worldMatrices, normalMatrices);
+            return;
+        case InstructionSet::SSE:
+            computeMatricesSse(transforms, count, worldMatrices, normalMatrices);
+            return;
+        case InstructionSet::Scalar:
+            break;
+    }
+#endif
+
+    computeMatricesScalar(transforms, count, worldMatrices, normalMatrices);
+}
+
+void computeMatricesScalar(const TransformArrays& transforms, const size_t count, glm::mat4* worldMatrices,
+                           glm::mat4* normalMatrices) {
+    for (size_t i = 0; i < count; ++i) {
+        const Transform transform{
+            { transforms.positionX[i], transforms.positionY[i], transforms.positionZ[i] },
+            { transforms.rotationW[i], transforms.rotationX[i], transforms.rotationY[i], transforms.rotationZ[i] },
+            { transforms.scaleX[i], transforms.scaleY[i], transforms.scaleZ[i] },
+        };
+
+        worldMatrices[i] = transform.getMatrix();
+        if (normalMatrices != nullptr) {
+            normalMatrices[i] = Transform::getNormalMatrix(worldMatrices[i]);
+        }
+    }
+}
+}  // namespace TransformKernels
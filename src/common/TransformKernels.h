@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Batch TRS to matrix kernels over structure of arrays inputs, for when many transforms change at once.
+// The widest instruction set supported at runtime is used, the scalar version is the reference.
+namespace TransformKernels {
+// `count` elements each
+struct TransformArrays {
+    const float* positionX;
+    const float* positionY;
+    const float* positionZ;
+
+    // Unit quaternions
+    const float* rotationX;
+    const float* rotationY;
+    const float* rotationZ;
+    const float* rotationW;
+
+    const float* scaleX;
+    const float* scaleY;
+    const float* scaleZ;
+};
+
+enum class InstructionSet {
+    Scalar,
+    SSE,
+    AVX2,
+};
+
+// Widest supported one, the narrower ones are supported too
+[[nodiscard]]
+InstructionSet getInstructionSet();
+
+[[nodiscard]]
+const char* getInstructionSetName(InstructionSet instructionSet);
+
+// worldMatrices[i] = T * R * S, as Transform::getMatrix().
+// normalMatrices[i] = the inverse transpose of its upper 3x3 (R * S^-1), widened to a mat4 as
+// Transform::getNormalMatrix(). normalMatrices may be null.
+void computeMatrices(const TransformArrays& transforms, size_t count, glm::mat4* worldMatrices,
+                     glm::mat4* normalMatrices);
+
+// Same, forcing an instruction set (tests, benchmarks). Throws if it isn't supported by this CPU.
+void computeMatrices(const TransformArrays& transforms, size_t count, glm::mat4* worldMatrices,
+                     glm::mat4* normalMatrices, InstructionSet instructionSet);
+
+void computeMatricesScalar(const TransformArrays& transforms, size_t count, glm::mat4* worldMatrices,
+                           glm::mat4* normalMatrices);
+}  // namespace TransformKernels
@@ -8,22 +8,16 @@
 #include "vk/vkutil.h"
 
 Camera::Camera(const float aspectRatio, const VkDescriptorPool& descriptorPool,
-               const VkDescriptorSetLayout& descriptorSetLayout) {
+               const VkDescriptorSetLayout& descriptorSetLayout, const UniformRing& uniformRing) {
+    setAspectRatio(aspectRatio);
+    m_createDescriptorSet(descriptorPool, descriptorSetLayout, uniformRing);
+}
+
+void Camera::setAspectRatio(const float aspectRatio) {
     m_projection = glm::perspective(glm::radians(60.0f), aspectRatio, 0.01f, 1000.0f);
 
     // TODO: change that
     m_projection[1][1] *= -1;  // inverting y because vulkan != gl
-
-    m_uniformBuffer =
-        std::make_unique<Buffer>(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    m_createDescriptorSet(descriptorPool, descriptorSetLayout);
-    update(0);
-}
-
-void Camera::destroy() const {
-    m_uniformBuffer->destroy();
 }
 
 glm::mat4 Camera::getView() const {
@@ -35,10 +29,6 @@ const glm::mat4& Camera::getProjection() const {
     return m_projection;
 }
 
-const Buffer& Camera::getUniform() const {
-    return *m_uniformBuffer;
-}
-
 const VkDescriptorSet& Camera::getDescriptorSet() const {
     return m_descriptorSet;
 }
@@ -73,18 +63,19 @@ void Camera::update(const float delta) {
     if (mouseDelta.y != 0) {
         rotate(-m_sensitivity * mouseDelta.y, { 1.0f, 0.0f, 0.0f });
     }
+}
 
+uint32_t Camera::pushUniforms(UniformRing& uniformRing) const {
     const UniformBufferObject ubo{
         .view = getView(),
         .projection = m_projection,
     };
 
-    // TODO: update only if changed
-    m_uniformBuffer->setMemory(&ubo);
+    return uniformRing.push(ubo);
 }
 
 void Camera::m_createDescriptorSet(const VkDescriptorPool& descriptorPool,
-                                   const VkDescriptorSetLayout& descriptorSetLayout) {
+                                   const VkDescriptorSetLayout& descriptorSetLayout, const UniformRing& uniformRing) {
     const VulkanContext& vkContext = VulkanContext::get();
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -95,17 +86,14 @@ void Camera::m_createDescriptorSet(const VkDescriptorPool& descriptorPool,
     VK_CHECK("failed to allocate descriptor sets",
              vkAllocateDescriptorSets(vkContext.getDevice(), &allocInfo, &m_descriptorSet));
 
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_uniformBuffer->buffer();
-    bufferInfo.range = m_uniformBuffer->getSize();
-    bufferInfo.offset = 0;
+    const VkDescriptorBufferInfo bufferInfo = uniformRing.getDescriptorInfo(sizeof(UniformBufferObject));
 
     VkWriteDescriptorSet descriptorWrite{};
     descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrite.dstSet = m_descriptorSet;
     descriptorWrite.dstBinding = 0;
     descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptorWrite.descriptorCount = 1;
     descriptorWrite.pBufferInfo = &bufferInfo;
 
@@ -4,34 +4,36 @@
 
 #include "common/Thing.h"
 #include "common/Transform.h"
-#include "vk/gpu_resources/Buffer.h"
+#include "vk/gpu_resources/UniformRing.h"
 
 class Camera : public Thing {
    public:
     explicit Camera(float aspectRatio, const VkDescriptorPool& descriptorPool,
-                    const VkDescriptorSetLayout& descriptorSetLayout);
+                    const VkDescriptorSetLayout& descriptorSetLayout, const UniformRing& uniformRing);
 
-    void destroy() const;
     void update(float delta);
 
+    // Rebuilds the projection, e.g. after a resize
+    void setAspectRatio(float aspectRatio);
+
+    // Writes this frame's view/projection into the ring, returns the dynamic offset to bind with
     [[nodiscard]]
-    glm::mat4 getView() const;
+    uint32_t pushUniforms(UniformRing& uniformRing) const;
 
     [[nodiscard]]
-    const glm::mat4& getProjection() const;
+    glm::mat4 getView() const;
 
     [[nodiscard]]
-    const Buffer& getUniform() const;
+    const glm::mat4& getProjection() const;
 
     [[nodiscard]]
     const VkDescriptorSet& getDescriptorSet() const;
 
    private:
-    void m_createDescriptorSet(const VkDescriptorPool& descriptorPool,
-                               const VkDescriptorSetLayout& descriptorSetLayout);
+    void m_createDescriptorSet(const VkDescriptorPool& descriptorPool, const VkDescriptorSetLayout& descriptorSetLayout,
+                               const UniformRing& uniformRing);
 
     VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
-    std::unique_ptr<Buffer> m_uniformBuffer;
     glm::mat4 m_projection{};
 
     float m_speed = 0.1f;
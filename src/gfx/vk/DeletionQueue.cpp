@@ -0,0 +1,49 @@
+#include "DeletionQueue.h"
+
+#include <vector>
+
+DeletionQueue& DeletionQueue::get() {
+    static DeletionQueue shared;
+    return shared;
+}
+
+void DeletionQueue::retire(std::function<void()>&& deleter) {
+    std::lock_guard lock(m_mutex);
+    m_entries.push_back({ m_submissionCount, std::move(deleter) });
+}
+
+uint64_t DeletionQueue::onSubmit() {
+    std::lock_guard lock(m_mutex);
+    return ++m_submissionCount;
+}
+
+void DeletionQueue::collect(const uint64_t completedSubmissions) {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard lock(m_mutex);
+        // Entries are pushed with a monotonic submission index, so the ready ones are all at the front
+        while (!m_entries.empty() && m_entries.front().submission < completedSubmissions) {
+            ready.push_back(std::move(m_entries.front().deleter));
+            m_entries.pop_front();
+        }
+    }
+
+    // Deleters run outside the lock as they may retire other objects
+    for (const auto& deleter : ready) {
+        deleter();
+    }
+}
+
+void DeletionQueue::flush() {
+    // Deleters may retire other objects (resources owned through a GpuHandle), which go in the next round
+    while (true) {
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_entries.empty()) {
+                return;
+            }
+        }
+
+        collect(UINT64_MAX);
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Vulkan objects and GeometryArena mesh ranges that may still be referenced by in-flight command buffers
+// are retired here and only destroyed once every submission made before their retirement has completed.
+class DeletionQueue {
+   public:
+    static DeletionQueue& get();
+
+    void retire(std::function<void()>&& deleter);
+
+    // Call right after a frame has been submitted, returns the value to pass to collect() once its fence signals
+    uint64_t onSubmit();
+
+    // Destroys everything retired before the `completedSubmissions`-th submission
+    void collect(uint64_t completedSubmissions);
+
+    // Destroys everything, including what the deleters retire. The device must be idle.
+    void flush();
+
+   private:
+    struct Entry {
+        uint64_t submission;  // Index of the first submission issued after retirement
+        std::function<void()> deleter;
+    };
+
+    DeletionQueue() = default;
+
+    std::mutex m_mutex;
+    std::deque<Entry> m_entries;
+    uint64_t m_submissionCount = 0;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "DeletionQueue.h"
+
+// Owning handle for GPU resources exposing a `destroy()` method (Buffer, Image, Texture, Pipeline...).
+// Releasing the handle hands the resource to the DeletionQueue instead of destroying it right away,
+// so it can be dropped while a frame using it is still in flight.
+template <typename T>
+class GpuHandle {
+   public:
+    GpuHandle() = default;
+    explicit GpuHandle(std::unique_ptr<T>&& resource) : m_resource(std::move(resource)) {}
+
+    GpuHandle(const GpuHandle&) = delete;
+    GpuHandle& operator=(const GpuHandle&) = delete;
+
+    GpuHandle(GpuHandle&& other) noexcept = default;
+    GpuHandle& operator=(GpuHandle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            m_resource = std::move(other.m_resource);
+        }
+
+        return *this;
+    }
+
+    ~GpuHandle() {
+        reset();
+    }
+
+    void reset() {
+        if (m_resource == nullptr) {
+            return;
+        }
+
+        DeletionQueue::get().retire([resource = std::shared_ptr<T>(std::move(m_resource))] { resource->destroy(); });
+    }
+
+    [[nodiscard]]
+    T* get() const {
+        return m_resource.get();
+    }
+
+    T* operator->() const {
+        return m_resource.get();
+    }
+
+    T& operator*() const {
+        return *m_resource;
+    }
+
+    explicit operator bool() const {
+        return m_resource != nullptr;
+    }
+
+   private:
+    std::unique_ptr<T> m_resource;
+};
+
+template <typename T, typename... Args>
+GpuHandle<T> makeGpuHandle(Args&&... args) {
+    return GpuHandle<T>(std::make_unique<T>(std::forward<Args>(args)...));
+}
@@ -0,0 +1,259 @@
+#include "HiZPyramid.h"
+
+#include <array>
+
+#include "DeletionQueue.h"
+#include "pipeline/PipelineReloader.h"
+#include "vkutil.h"
+
+constexpr uint32_t reduceWorkgroupSize = 8;  // Keep in sync with shaders/hiz.comp
+
+HiZPyramid::HiZPyramid() {
+    const VkDevice& device = VulkanContext::get().getDevice();
+
+    // Only texelFetch is used, filtering doesn't matter
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    VK_CHECK("failed to create hi-z sampler", vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler));
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings = bindings.data();
+
+    VK_CHECK("failed to create hi-z descriptor set layout",
+             vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout));
+
+    VkPushConstantRange pushConstant{};
+    pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstant.offset = 0;
+    pushConstant.size = sizeof(ReduceConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+
+    VK_CHECK("failed to create hi-z pipeline layout",
+             vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+    const auto build = [this] { return std::make_unique<Pipeline>("./shaders/hiz.comp", m_pipelineLayout); };
+    m_reducePipeline = GpuHandle<Pipeline>(build());
+    PipelineReloader::get().watch(m_reducePipeline, { "./shaders/hiz.comp" }, build);
+}
+
+void HiZPyramid::destroy() {
+    m_retireResources();
+
+    const VkDevice& device = VulkanContext::get().getDevice();
+    m_reducePipeline.reset();
+    vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+    vkDestroySampler(device, m_sampler, nullptr);
+}
+
+void HiZPyramid::resize(const DepthImage& depthImage) {
+    m_retireResources();
+    ++m_generation;
+
+    const VkDevice& device = VulkanContext::get().getDevice();
+    Resources& res = m_resources;
+
+    // Level sizes are rounded up so that texel footprints stay aligned to powers of two
+    res.depthExtent = { depthImage.getExtent().width, depthImage.getExtent().height };
+    VkExtent2D extent = res.depthExtent;
+    do {
+        extent = { (extent.width + 1) / 2, (extent.height + 1) / 2 };
+        res.levelExtents.push_back(extent);
+    } while (extent.width > 1 || extent.height > 1);
+
+    const uint32_t levelCount = res.levelExtents.size();
+    res.image = makeGpuHandle<Image>(
+        VkExtent3D{ res.levelExtents[0].width, res.levelExtents[0].height, 1 }, VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::RenderTarget, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_VIEW_TYPE_2D, levelCount);
+
+    res.levelViews.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = res.image->getImage();
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VK_CHECK("failed to create hi-z level view",
+                 vkCreateImageView(device, &viewInfo, nullptr, &res.levelViews[level]));
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = levelCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = levelCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = levelCount;
+
+    VK_CHECK("failed to create hi-z descriptor pool",
+             vkCreateDescriptorPool(device, &poolInfo, nullptr, &res.descriptorPool));
+
+    const std::vector layouts(levelCount, m_descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = res.descriptorPool;
+    allocInfo.descriptorSetCount = levelCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    res.descriptorSets.resize(levelCount);
+    VK_CHECK("failed to allocate hi-z descriptor sets",
+             vkAllocateDescriptorSets(device, &allocInfo, res.descriptorSets.data()));
+
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        VkDescriptorImageInfo srcInfo{};
+        srcInfo.sampler = m_sampler;
+        if (level == 0) {
+            srcInfo.imageView = depthImage.getImageView();
+            srcInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        } else {
+            srcInfo.imageView = res.levelViews[level - 1];
+            srcInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkDescriptorImageInfo dstInfo{};
+        dstInfo.imageView = res.levelViews[level];
+        dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        std::array<VkWriteDescriptorSet, 2> writes{};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = res.descriptorSets[level];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].descriptorCount = 1;
+        writes[0].pImageInfo = &srcInfo;
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = res.descriptorSets[level];
+        writes[1].dstBinding = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].descriptorCount = 1;
+        writes[1].pImageInfo = &dstInfo;
+
+        vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, nullptr);
+    }
+}
+
+void HiZPyramid::build(const VkCommandBuffer& commandBuffer) const {
+    const Resources& res = m_resources;
+
+    m_reducePipeline->bind(commandBuffer);
+
+    VkExtent2D srcExtent = res.depthExtent;
+    for (uint32_t level = 0; level < res.levelExtents.size(); ++level) {
+        const VkExtent2D& dstExtent = res.levelExtents[level];
+
+        const ReduceConstants constants{
+            static_cast<int32_t>(srcExtent.width),
+            static_cast<int32_t>(srcExtent.height),
+            static_cast<int32_t>(dstExtent.width),
+            static_cast<int32_t>(dstExtent.height),
+        };
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1,
+                                &res.descriptorSets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants),
+                           &constants);
+        vkCmdDispatch(commandBuffer, (dstExtent.width + reduceWorkgroupSize - 1) / reduceWorkgroupSize,
+                      (dstExtent.height + reduceWorkgroupSize - 1) / reduceWorkgroupSize, 1);
+
+        // This level is the next one's input, the last one is synchronized by whoever reads the pyramid
+        if (level + 1 < res.levelExtents.size()) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = res.image->getImage();
+            barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
+        srcExtent = dstExtent;
+    }
+}
+
+VkDescriptorImageInfo HiZPyramid::getDescriptorInfo() const {
+    VkDescriptorImageInfo info{};
+    info.sampler = m_sampler;
+    info.imageView = m_resources.image->getImageView();
+    info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    return info;
+}
+
+VkImage HiZPyramid::getImage() const {
+    return m_resources.image->getImage();
+}
+
+uint32_t HiZPyramid::getGeneration() const {
+    return m_generation;
+}
+
+uint32_t HiZPyramid::getMipLevels() const {
+    return m_resources.levelExtents.size();
+}
+
+glm::vec2 HiZPyramid::getDepthSize() const {
+    return { m_resources.depthExtent.width, m_resources.depthExtent.height };
+}
+
+void HiZPyramid::m_retireResources() {
+    if (!m_resources.image) {
+        return;
+    }
+
+    // Retired in this order, the views go before their image
+    DeletionQueue::get().retire([descriptorPool = m_resources.descriptorPool, levelViews = m_resources.levelViews] {
+        const VkDevice& device = VulkanContext::get().getDevice();
+
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        for (const VkImageView& view : levelViews) {
+            vkDestroyImageView(device, view, nullptr);
+        }
+    });
+    m_resources.image.reset();
+
+    m_resources = {};
+}
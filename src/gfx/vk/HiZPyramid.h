@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "GpuHandle.h"
+#include "gpu_resources/DepthImage.h"
+#include "gpu_resources/Image.h"
+#include "pipeline/Pipeline.h"
+
+// Hierarchical depth: each mip holds the farthest depth of the 2x2 texels below it, mip 0 being half the
+// depth buffer resolution. Texel (x, y) of mip k covers depth pixels [x, y] * 2^(k + 1) to [x + 1, y + 1] * 2^(k + 1).
+class HiZPyramid {
+   public:
+    HiZPyramid();
+
+    void destroy();
+
+    // (Re)creates the pyramid for a new depth image, the previous one is retired through the DeletionQueue.
+    // The new image is left UNDEFINED, the caller transitions it to GENERAL in the frame that first builds it.
+    void resize(const DepthImage& depthImage);
+
+    // Reduces the depth image, which must have been rendered to (DEPTH_STENCIL_READ_ONLY_OPTIMAL).
+    // Only the barriers between levels are recorded, the pass reads the depth and writes the whole pyramid (GENERAL).
+    void build(const VkCommandBuffer& commandBuffer) const;
+
+    // Whole pyramid, GENERAL layout
+    [[nodiscard]]
+    VkDescriptorImageInfo getDescriptorInfo() const;
+
+    [[nodiscard]]
+    VkImage getImage() const;
+
+    // Changes on every resize, descriptors referencing the pyramid must be rewritten then
+    [[nodiscard]]
+    uint32_t getGeneration() const;
+
+    [[nodiscard]]
+    uint32_t getMipLevels() const;
+
+    // Resolution of the depth image the pyramid is built from
+    [[nodiscard]]
+    glm::vec2 getDepthSize() const;
+
+   private:
+    struct Resources {
+        GpuHandle<Image> image;
+        std::vector<VkImageView> levelViews;
+        std::vector<VkExtent2D> levelExtents;
+        VkExtent2D depthExtent{};
+
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSet> descriptorSets;  // One per level: previous level (or depth) -> level
+    };
+
+    struct ReduceConstants {
+        int32_t srcWidth;
+        int32_t srcHeight;
+        int32_t dstWidth;
+        int32_t dstHeight;
+    };
+
+    void m_retireResources();
+
+    Resources m_resources;
+    uint32_t m_generation = 0;
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    GpuHandle<Pipeline> m_reducePipeline;
+};
@@ -0,0 +1,371 @@
+#include "IndirectRenderer.h"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "gpu_resources/GeometryArena.h"
+#include "pipeline/PipelineReloader.h"
+#include "types/VulkanContext.h"
+#include "vkutil.h"
+
+constexpr uint32_t cullWorkgroupSize = 64;  // Keep in sync with shaders/cull.comp
+
+IndirectRenderer::IndirectRenderer(const uint32_t framesInFlight, const uint32_t maxObjects,
+                                   const uint32_t maxMaterials)
+    : m_maxObjects(maxObjects), m_maxMaterials(maxMaterials) {
+    m_frames.resize(framesInFlight);
+    for (FrameResources& frame : m_frames) {
+        frame.objects = makeGpuHandle<Buffer>(
+            sizeof(ObjectData) * m_maxObjects, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::DrawData);
+        frame.mappedObjects = static_cast<ObjectData*>(frame.objects->map());
+
+        // Transfer dst: both are cleared with vkCmdFillBuffer before culling
+        frame.drawCommands = makeGpuHandle<Buffer>(
+            sizeof(VkDrawIndexedIndirectCommand) * m_maxObjects,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::DrawData);
+
+        frame.drawCounts = makeGpuHandle<Buffer>(
+            sizeof(uint32_t) * m_maxMaterials,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::DrawData);
+
+        frame.cullUniforms = makeGpuHandle<Buffer>(
+            sizeof(CullUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Uniform);
+        frame.mappedCullUniforms = static_cast<CullUniforms*>(frame.cullUniforms->map());
+    }
+
+    m_createDescriptors();
+    m_createCullPipeline();
+}
+
+void IndirectRenderer::destroy() {
+    const VkDevice& device = VulkanContext::get().getDevice();
+
+    for (FrameResources& frame : m_frames) {
+        frame.objects->unmap();
+        frame.objects.reset();
+        frame.drawCommands.reset();
+        frame.drawCounts.reset();
+        frame.cullUniforms->unmap();
+        frame.cullUniforms.reset();
+    }
+
+    m_cullPipeline.reset();
+    vkDestroyPipelineLayout(device, m_cullPipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, m_cullSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, m_objectSetLayout, nullptr);
+}
+
+bool IndirectRenderer::isSupported() {
+    const VkPhysicalDeviceFeatures& features = VulkanContext::get().getEnabledFeatures();
+    return features.multiDrawIndirect && features.drawIndirectFirstInstance;
+}
+
+const VkDescriptorSetLayout& IndirectRenderer::getObjectSetLayout() const {
+    return m_objectSetLayout;
+}
+
+void IndirectRenderer::update(const uint32_t frameIndex, const EntityStore& entities) {
+    FrameResources& frame = m_frames[frameIndex];
+
+    if (frame.structureVersion != entities.getStructureVersion()) {
+        m_rebuildObjects(frame, entities);
+    } else if (frame.lastChange != entities.getLastChange()) {
+        m_updateMovedObjects(frame, entities);
+    }
+
+    frame.structureVersion = entities.getStructureVersion();
+    frame.lastChange = entities.getLastChange();
+}
+
+void IndirectRenderer::m_rebuildObjects(FrameResources& frame, const EntityStore& entities) const {
+    frame.batches.clear();
+
+    const std::vector<MaterialRef>& materials = entities.getMaterials();
+
+    // A material is a texture and the features selecting its pipeline permutation
+    const auto getMaterialKey = [](const MaterialRef& material) {
+        return static_cast<uint64_t>(material.textureID) << 32 | material.features;
+    };
+
+    // First pass: one batch per material, sized by the number of entities using it
+    std::unordered_map<uint64_t, uint32_t> materialIndices;
+    const uint32_t objectCount = entities.size();
+    for (const MaterialRef& material : materials) {
+        auto [it, inserted] = materialIndices.try_emplace(getMaterialKey(material), frame.batches.size());
+        if (inserted) {
+            frame.batches.push_back({ .textureID = material.textureID, .materialFeatures = material.features });
+        }
+
+        ++frame.batches[it->second].capacity;
+    }
+
+    if (objectCount > m_maxObjects || frame.batches.size() > m_maxMaterials) {
+        throw std::runtime_error(fmt::format("indirect renderer: {} objects / {} materials exceed {} / {}",
+                                             objectCount, frame.batches.size(), m_maxObjects, m_maxMaterials));
+    }
+
+    uint32_t drawOffset = 0;
+    for (Batch& batch : frame.batches) {
+        batch.drawOffset = drawOffset;
+        drawOffset += batch.capacity;
+    }
+
+    // Second pass: object data, written straight into the persistently mapped buffer
+    const std::vector<glm::mat4>& worldMatrices = entities.getWorldMatrices();
+    const std::vector<glm::mat4>& normalMatrices = entities.getNormalMatrices();
+    const std::vector<const Mesh*>& meshes = entities.getMeshes();
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        const uint32_t materialIndex = materialIndices[getMaterialKey(materials[i])];
+        const MeshRange& range = meshes[i]->getRange();
+
+        ObjectData& object = frame.mappedObjects[i];
+        object.modelMatrix = worldMatrices[i];
+        object.normalMatrix = normalMatrices[i];
+        object.boundingSphere = meshes[i]->getBoundingSphere();
+        object.vertexOffset = range.vertexOffset;
+        object.firstIndex = range.firstIndex;
+        object.indexCount = range.indexCount;
+        object.materialIndex = materialIndex;
+        object.drawOffset = frame.batches[materialIndex].drawOffset;
+    }
+
+    frame.objectCount = objectCount;
+}
+
+void IndirectRenderer::m_updateMovedObjects(FrameResources& frame, const EntityStore& entities) {
+    // Same entities at the same dense indices: materials, meshes and batches are unchanged
+    const std::vector<uint64_t>& changeStamps = entities.getChangeStamps();
+    const std::vector<glm::mat4>& worldMatrices = entities.getWorldMatrices();
+    const std::vector<glm::mat4>& normalMatrices = entities.getNormalMatrices();
+    for (uint32_t i = 0; i < frame.objectCount; ++i) {
+        if (changeStamps[i] > frame.lastChange) {
+            frame.mappedObjects[i].modelMatrix = worldMatrices[i];
+            frame.mappedObjects[i].normalMatrix = normalMatrices[i];
+        }
+    }
+}
+
+void IndirectRenderer::clear(const VkCommandBuffer& commandBuffer, const uint32_t frameIndex) const {
+    const FrameResources& frame = m_frames[frameIndex];
+
+    vkCmdFillBuffer(commandBuffer, frame.drawCounts->buffer(), 0, VK_WHOLE_SIZE, 0);
+    if (!VulkanContext::get().hasDrawIndirectCount()) {
+        // Without a count buffer every slot of a batch is drawn, culled slots must be zero instance draws
+        vkCmdFillBuffer(commandBuffer, frame.drawCommands->buffer(), 0, VK_WHOLE_SIZE, 0);
+    }
+}
+
+void IndirectRenderer::cull(const VkCommandBuffer& commandBuffer, const uint32_t frameIndex, const Frustum& frustum,
+                            const glm::mat4& previousViewProjection, const HiZPyramid& hiZ, const bool occlusion) {
+    FrameResources& frame = m_frames[frameIndex];
+    const VkDevice& device = VulkanContext::get().getDevice();
+
+    // The frame's fence has been waited on, its set isn't in use anymore
+    if (frame.hiZGeneration != hiZ.getGeneration()) {
+        const VkDescriptorImageInfo hiZInfo = hiZ.getDescriptorInfo();
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = frame.cullSet;
+        write.dstBinding = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &hiZInfo;
+
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        frame.hiZGeneration = hiZ.getGeneration();
+    }
+
+    CullUniforms& uniforms = *frame.mappedCullUniforms;
+    uniforms.frustumPlanes = frustum.planes;
+    uniforms.previousViewProjection = previousViewProjection;
+    uniforms.depthSize = hiZ.getDepthSize();
+    uniforms.objectCount = frame.objectCount;
+    uniforms.occlusionEnabled = occlusion;
+    uniforms.hiZLevels = hiZ.getMipLevels();
+
+    const std::array sets{ frame.descriptorSet, frame.cullSet };
+
+    m_cullPipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, sets.size(),
+                            sets.data(), 0, nullptr);
+    vkCmdDispatch(commandBuffer, (frame.objectCount + cullWorkgroupSize - 1) / cullWorkgroupSize, 1, 1);
+}
+
+uint32_t IndirectRenderer::getBatchCount(const uint32_t frameIndex) const {
+    return m_frames[frameIndex].batches.size();
+}
+
+VkBuffer IndirectRenderer::getDrawCommandBuffer(const uint32_t frameIndex) const {
+    return m_frames[frameIndex].drawCommands->buffer();
+}
+
+VkBuffer IndirectRenderer::getDrawCountBuffer(const uint32_t frameIndex) const {
+    return m_frames[frameIndex].drawCounts->buffer();
+}
+
+void IndirectRenderer::submit(RenderQueue& queue, const uint32_t frameIndex,
+                              const ScenePipelineResolver& resolvePipeline,
+                              const std::vector<Texture>& textures) const {
+    const FrameResources& frame = m_frames[frameIndex];
+    const GeometryArena& arena = GeometryArena::get();
+    const bool hasDrawCount = VulkanContext::get().hasDrawIndirectCount();
+
+    for (uint32_t i = 0; i < frame.batches.size(); ++i) {
+        const Batch& batch = frame.batches[i];
+
+        // The batch's draws are still culled and counted, they just aren't recorded
+        const Pipeline* pipeline = resolvePipeline(batch.materialFeatures);
+        if (pipeline == nullptr) {
+            continue;
+        }
+
+        RenderItem item{};
+        item.pipeline = pipeline;
+        item.materialSet = textures[batch.textureID].getDescriptorSet();
+        item.objectSet = frame.descriptorSet;
+        item.vertexBuffer = arena.getVertexBuffer().buffer();
+        item.indexBuffer = arena.getIndexBuffer().buffer();
+
+        // Without a count buffer, culled slots are zero instance draws
+        item.drawType =
+            hasDrawCount ? RenderItem::DrawType::IndexedIndirectCount : RenderItem::DrawType::IndexedIndirect;
+        item.indirect.buffer = frame.drawCommands->buffer();
+        item.indirect.offset = static_cast<VkDeviceSize>(batch.drawOffset) * sizeof(VkDrawIndexedIndirectCommand);
+        item.indirect.countBuffer = frame.drawCounts->buffer();
+        item.indirect.countOffset = sizeof(uint32_t) * i;
+        item.indirect.maxDrawCount = batch.capacity;
+
+        // Depth is only known on the GPU
+        queue.push(item, { .pass = RenderQueue::Pass::Opaque, .material = static_cast<uint32_t>(batch.textureID) });
+    }
+}
+
+void IndirectRenderer::m_createDescriptors() {
+    const VulkanContext& vkContext = VulkanContext::get();
+
+    // 0: objects, 1: draw commands, 2: draw counts. Only the objects are read by the vertex shader
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings = bindings.data();
+
+    VK_CHECK("failed to create object descriptor set layout",
+             vkCreateDescriptorSetLayout(vkContext.getDevice(), &layoutInfo, nullptr, &m_objectSetLayout));
+
+    // 0: cull uniforms, 1: hi-z pyramid
+    std::array<VkDescriptorSetLayoutBinding, 2> cullBindings{};
+    cullBindings[0].binding = 0;
+    cullBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cullBindings[0].descriptorCount = 1;
+    cullBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullBindings[1].binding = 1;
+    cullBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cullBindings[1].descriptorCount = 1;
+    cullBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    layoutInfo.bindingCount = cullBindings.size();
+    layoutInfo.pBindings = cullBindings.data();
+
+    VK_CHECK("failed to create cull descriptor set layout",
+             vkCreateDescriptorSetLayout(vkContext.getDevice(), &layoutInfo, nullptr, &m_cullSetLayout));
+
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = bindings.size() * m_frames.size();
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = m_frames.size();
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = m_frames.size();
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 2 * m_frames.size();
+
+    VK_CHECK("failed to create object descriptor pool",
+             vkCreateDescriptorPool(vkContext.getDevice(), &poolInfo, nullptr, &m_descriptorPool));
+
+    for (FrameResources& frame : m_frames) {
+        const std::array setLayouts{ m_objectSetLayout, m_cullSetLayout };
+        std::array<VkDescriptorSet, 2> sets{};
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_descriptorPool;
+        allocInfo.descriptorSetCount = setLayouts.size();
+        allocInfo.pSetLayouts = setLayouts.data();
+
+        VK_CHECK("failed to allocate object descriptor sets",
+                 vkAllocateDescriptorSets(vkContext.getDevice(), &allocInfo, sets.data()));
+        frame.descriptorSet = sets[0];
+        frame.cullSet = sets[1];
+
+        const std::array<VkDescriptorBufferInfo, 3> bufferInfos{ {
+            { frame.objects->buffer(), 0, VK_WHOLE_SIZE },
+            { frame.drawCommands->buffer(), 0, VK_WHOLE_SIZE },
+            { frame.drawCounts->buffer(), 0, VK_WHOLE_SIZE },
+        } };
+
+        std::array<VkWriteDescriptorSet, 3> writes{};
+        for (uint32_t i = 0; i < writes.size(); ++i) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = frame.descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].descriptorCount = 1;
+            writes[i].pBufferInfo = &bufferInfos[i];
+        }
+
+        vkUpdateDescriptorSets(vkContext.getDevice(), writes.size(), writes.data(), 0, nullptr);
+
+        // The hi-z binding is written on first use, see cull()
+        const VkDescriptorBufferInfo uniformInfo{ frame.cullUniforms->buffer(), 0, VK_WHOLE_SIZE };
+
+        VkWriteDescriptorSet uniformWrite{};
+        uniformWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        uniformWrite.dstSet = frame.cullSet;
+        uniformWrite.dstBinding = 0;
+        uniformWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uniformWrite.descriptorCount = 1;
+        uniformWrite.pBufferInfo = &uniformInfo;
+
+        vkUpdateDescriptorSets(vkContext.getDevice(), 1, &uniformWrite, 0, nullptr);
+    }
+}
+
+void IndirectRenderer::m_createCullPipeline() {
+    // Too large for the guaranteed 128 bytes of push constants, the cull parameters are a uniform buffer
+    const std::array setLayouts{ m_objectSetLayout, m_cullSetLayout };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = setLayouts.size();
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+
+    VK_CHECK("failed to create cull pipeline layout",
+             vkCreatePipelineLayout(VulkanContext::get().getDevice(), &pipelineLayoutInfo, nullptr,
+                                    &m_cullPipelineLayout));
+
+    const auto build = [this] { return std::make_unique<Pipeline>("./shaders/cull.comp", m_cullPipelineLayout); };
+    m_cullPipeline = GpuHandle<Pipeline>(build());
+    PipelineReloader::get().watch(m_cullPipeline, { "./shaders/cull.comp" }, build);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+#include <vector>
+
+#include "GpuHandle.h"
+#include "HiZPyramid.h"
+#include "RenderQueue.h"
+#include "common/Frustum.h"
+#include "gpu_resources/Buffer.h"
+#include "gpu_resources/Texture.h"
+#include "objects/EntityStore.h"
+#include "pipeline/Pipeline.h"
+#include "types/ObjectData.h"
+
+// GPU driven path: per-object data lives in a storage buffer, a compute pass frustum and occlusion culls it
+// and writes one compacted VkDrawIndexedIndirectCommand list per material, drawn with one indirect call each.
+class IndirectRenderer {
+   public:
+    IndirectRenderer(uint32_t framesInFlight, uint32_t maxObjects, uint32_t maxMaterials);
+
+    void destroy();
+
+    // multiDrawIndirect and drawIndirectFirstInstance are required
+    [[nodiscard]]
+    static bool isSupported();
+
+    // Shared by the culling pass (set 0) and the indirect graphics pipeline
+    [[nodiscard]]
+    const VkDescriptorSetLayout& getObjectSetLayout() const;
+
+    // Brings the frame's object list up to date, must be called once the frame's fence is signaled.
+    // Object data stays in the frame's buffer: only the entities moved since its last update are rewritten,
+    // everything is only rebuilt when entities were created or destroyed.
+    void update(uint32_t frameIndex, const EntityStore& entities);
+
+    // Resets the draw counts (and commands without drawIndirectCount), a transfer write of both draw buffers
+    void clear(const VkCommandBuffer& commandBuffer, uint32_t frameIndex) const;
+
+    // Records the culling dispatch, outside of any render pass. Writes both draw buffers from compute,
+    // barriers are left to the caller (see RenderGraph).
+    // With occlusion, objects are tested against the previous frame's depth (built into hiZ beforehand),
+    // reprojected with previousViewProjection.
+    void cull(const VkCommandBuffer& commandBuffer, uint32_t frameIndex, const Frustum& frustum,
+              const glm::mat4& previousViewProjection, const HiZPyramid& hiZ, bool occlusion);
+
+    // One batch per material
+    [[nodiscard]]
+    uint32_t getBatchCount(uint32_t frameIndex) const;
+
+    [[nodiscard]]
+    VkBuffer getDrawCommandBuffer(uint32_t frameIndex) const;
+
+    [[nodiscard]]
+    VkBuffer getDrawCountBuffer(uint32_t frameIndex) const;
+
+    // One opaque indirect item per batch
+    void submit(RenderQueue& queue, uint32_t frameIndex, const ScenePipelineResolver& resolvePipeline,
+                const std::vector<Texture>& textures) const;
+
+   private:
+    struct Batch {
+        Texture::ID textureID;
+        MaterialFeatures materialFeatures;
+        uint32_t drawOffset = 0;
+        uint32_t capacity = 0;  // Objects using this material, i.e. max draws
+    };
+
+    // std140, keep in sync with shaders/cull.comp
+    struct CullUniforms {
+        std::array<glm::vec4, Frustum::Count> frustumPlanes;
+        glm::mat4 previousViewProjection;
+        glm::vec2 depthSize;
+        uint32_t objectCount;
+        uint32_t occlusionEnabled;
+        uint32_t hiZLevels;
+        uint32_t __padding[3];
+    };
+
+    struct FrameResources {
+        GpuHandle<Buffer> objects;
+        GpuHandle<Buffer> drawCommands;
+        GpuHandle<Buffer> drawCounts;
+        ObjectData* mappedObjects = nullptr;
+
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+        GpuHandle<Buffer> cullUniforms;
+        CullUniforms* mappedCullUniforms = nullptr;
+        VkDescriptorSet cullSet = VK_NULL_HANDLE;
+        uint32_t hiZGeneration = 0;  // Pyramid generation written in cullSet, 0 is never valid
+
+        std::vector<Batch> batches;
+        uint32_t objectCount = 0;
+
+        // EntityStore state the object buffer reflects
+        uint64_t structureVersion = 0;
+        uint64_t lastChange = 0;
+    };
+
+    void m_rebuildObjects(FrameResources& frame, const EntityStore& entities) const;
+    static void m_updateMovedObjects(FrameResources& frame, const EntityStore& entities);
+
+    void m_createDescriptors();
+    void m_createCullPipeline();
+
+    uint32_t m_maxObjects;
+    uint32_t m_maxMaterials;
+
+    std::vector<FrameResources> m_frames;
+
+    VkDescriptorSetLayout m_objectSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;  // Cull uniforms and the hi-z pyramid
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+
+    VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+    GpuHandle<Pipeline> m_cullPipeline;
+};
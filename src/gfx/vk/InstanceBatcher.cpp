@@ -0,0 +1,165 @@
+#include "InstanceBatcher.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "gpu_resources/GeometryArena.h"
+#include "types/VulkanContext.h"
+#include "vkutil.h"
+
+InstanceBatcher::InstanceBatcher(const uint32_t framesInFlight, const uint32_t maxInstances,
+                                 const VkDescriptorSetLayout& objectSetLayout)
+    : m_maxInstances(maxInstances) {
+    const VkDevice& device = VulkanContext::get().getDevice();
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 3 * framesInFlight;  // The object set layout has 3 storage buffer bindings
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = framesInFlight;
+
+    VK_CHECK("failed to create instance descriptor pool",
+             vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool));
+
+    m_frames.resize(framesInFlight);
+    for (FrameResources& frame : m_frames) {
+        frame.instances = makeGpuHandle<Buffer>(
+            sizeof(ObjectData) * m_maxInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::DrawData);
+        frame.mappedInstances = static_cast<ObjectData*>(frame.instances->map());
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &objectSetLayout;
+
+        VK_CHECK("failed to allocate instance descriptor set",
+                 vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet));
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = frame.instances->buffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = frame.descriptorSet;
+        write.dstBinding = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &bufferInfo;
+
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+}
+
+void InstanceBatcher::destroy() {
+    for (FrameResources& frame : m_frames) {
+        frame.instances->unmap();
+        frame.instances.reset();
+    }
+
+    vkDestroyDescriptorPool(VulkanContext::get().getDevice(), m_descriptorPool, nullptr);
+}
+
+void InstanceBatcher::update(const uint32_t frameIndex, const EntityStore& entities, const glm::vec3& viewPosition) {
+    FrameResources& frame = m_frames[frameIndex];
+    frame.batches.clear();
+    m_batchIndices.clear();
+
+    const std::vector<uint8_t>& visibility = entities.getVisibility();
+    const std::vector<const Mesh*>& meshes = entities.getMeshes();
+    const std::vector<MaterialRef>& materials = entities.getMaterials();
+
+    // First pass: count the instances of every (mesh, material) pair, in first seen order.
+    // The batch of every visible entity is kept for the second pass.
+    m_entityBatches.resize(entities.size());
+    uint32_t instanceCount = 0;
+    for (uint32_t i = 0; i < entities.size(); ++i) {
+        if (!visibility[i]) {
+            continue;
+        }
+
+        const BatchKey key{ meshes[i], materials[i].textureID, materials[i].features };
+        auto [it, inserted] = m_batchIndices.try_emplace(key, frame.batches.size());
+        if (inserted) {
+            frame.batches.push_back({ .key = key });
+        }
+
+        m_entityBatches[i] = it->second;
+        ++frame.batches[it->second].instanceCount;
+        ++instanceCount;
+    }
+
+    if (instanceCount > m_maxInstances) {
+        throw std::runtime_error(
+            fmt::format("instance batcher: {} instances exceed {}", instanceCount, m_maxInstances));
+    }
+
+    // Instances of a batch are contiguous, starting at firstInstance
+    m_batchCursors.resize(frame.batches.size());
+    uint32_t firstInstance = 0;
+    for (uint32_t i = 0; i < frame.batches.size(); ++i) {
+        frame.batches[i].firstInstance = firstInstance;
+        m_batchCursors[i] = firstInstance;
+        firstInstance += frame.batches[i].instanceCount;
+    }
+
+    // Second pass: instance data, written straight into the persistently mapped buffer
+    const std::vector<glm::mat4>& worldMatrices = entities.getWorldMatrices();
+    const std::vector<glm::mat4>& normalMatrices = entities.getNormalMatrices();
+    for (uint32_t i = 0; i < entities.size(); ++i) {
+        if (!visibility[i]) {
+            continue;
+        }
+
+        const uint32_t batchIndex = m_entityBatches[i];
+        Batch& batch = frame.batches[batchIndex];
+        batch.depth = std::min(batch.depth, glm::distance(viewPosition, glm::vec3(worldMatrices[i][3])));
+
+        ObjectData& instance = frame.mappedInstances[m_batchCursors[batchIndex]++];
+        instance.modelMatrix = worldMatrices[i];
+        instance.normalMatrix = normalMatrices[i];
+        instance.boundingSphere = meshes[i]->getBoundingSphere();
+    }
+}
+
+uint32_t InstanceBatcher::getBatchCount(const uint32_t frameIndex) const {
+    return m_frames[frameIndex].batches.size();
+}
+
+void InstanceBatcher::submit(RenderQueue& queue, const uint32_t frameIndex,
+                             const ScenePipelineResolver& resolvePipeline, const std::vector<Texture>& textures) const {
+    const FrameResources& frame = m_frames[frameIndex];
+    const GeometryArena& arena = GeometryArena::get();
+
+    for (const Batch& batch : frame.batches) {
+        const Pipeline* pipeline = resolvePipeline(batch.key.materialFeatures);
+        if (pipeline == nullptr) {
+            continue;
+        }
+
+        const MeshRange& range = batch.key.mesh->getRange();
+
+        RenderItem item{};
+        item.pipeline = pipeline;
+        item.materialSet = textures[batch.key.textureID].getDescriptorSet();
+        item.objectSet = frame.descriptorSet;
+        item.vertexBuffer = arena.getVertexBuffer().buffer();
+        item.indexBuffer = arena.getIndexBuffer().buffer();
+        item.indexed = { range.indexCount, batch.instanceCount, range.firstIndex, range.vertexOffset,
+                         batch.firstInstance };
+
+        queue.push(item, { .pass = RenderQueue::Pass::Opaque,
+                           .material = static_cast<uint32_t>(batch.key.textureID),
+                           .mesh = batch.key.mesh->getID(),
+                           .depth = batch.depth });
+    }
+}
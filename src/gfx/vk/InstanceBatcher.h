@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "GpuHandle.h"
+#include "RenderQueue.h"
+#include "gpu_resources/Buffer.h"
+#include "gpu_resources/Texture.h"
+#include "objects/EntityStore.h"
+#include "types/ObjectData.h"
+
+// CPU path instancing: entities are grouped by mesh and material, every group is submitted as a single
+// instanced draw. Per-instance data is read from a storage buffer through gl_InstanceIndex,
+// with the same layout as the GPU driven path.
+class InstanceBatcher {
+   public:
+    // objectSetLayout is the set 2 layout of the graphics pipeline layout, only binding 0 is written
+    InstanceBatcher(uint32_t framesInFlight, uint32_t maxInstances, const VkDescriptorSetLayout& objectSetLayout);
+
+    void destroy();
+
+    // Groups the visible entities, must be called once the frame's fence is signaled
+    void update(uint32_t frameIndex, const EntityStore& entities, const glm::vec3& viewPosition);
+
+    [[nodiscard]]
+    uint32_t getBatchCount(uint32_t frameIndex) const;
+
+    // One opaque item per batch, sorted on its closest instance
+    void submit(RenderQueue& queue, uint32_t frameIndex, const ScenePipelineResolver& resolvePipeline,
+                const std::vector<Texture>& textures) const;
+
+   private:
+    struct BatchKey {
+        const Mesh* mesh;
+        Texture::ID textureID;
+        MaterialFeatures materialFeatures;
+
+        bool operator==(const BatchKey& other) const = default;
+    };
+
+    struct BatchKeyHash {
+        size_t operator()(const BatchKey& key) const {
+            return std::hash<const Mesh*>()(key.mesh) ^ (std::hash<Texture::ID>()(key.textureID) << 1) ^
+                   (std::hash<MaterialFeatures>()(key.materialFeatures) << 2);
+        }
+    };
+
+    struct Batch {
+        BatchKey key;
+        uint32_t firstInstance = 0;
+        uint32_t instanceCount = 0;
+        float depth = std::numeric_limits<float>::max();
+    };
+
+    struct FrameResources {
+        GpuHandle<Buffer> instances;
+        ObjectData* mappedInstances = nullptr;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+        std::vector<Batch> batches;
+    };
+
+    uint32_t m_maxInstances;
+
+    std::vector<FrameResources> m_frames;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+
+    // Reused across frames to avoid reallocating
+    std::unordered_map<BatchKey, uint32_t, BatchKeyHash> m_batchIndices;
+    std::vector<uint32_t> m_batchCursors;
+    std::vector<uint32_t> m_entityBatches;  // Per dense entity index, only set for visible ones
+};
@@ -0,0 +1,166 @@
+#include "MemoryTracker.h"
+
+#include <fmt/base.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <json.hpp>
+#include <stdexcept>
+
+#include "types/VulkanContext.h"
+
+const char* toString(const MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Geometry:
+            return "geometry";
+        case MemoryCategory::Texture:
+            return "texture";
+        case MemoryCategory::RenderTarget:
+            return "render_target";
+        case MemoryCategory::Staging:
+            return "staging";
+        case MemoryCategory::Uniform:
+            return "uniform";
+        case MemoryCategory::DrawData:
+            return "draw_data";
+        default:
+            return "unknown";
+    }
+}
+
+MemoryTracker& MemoryTracker::get() {
+    static MemoryTracker shared;
+    return shared;
+}
+
+void MemoryTracker::onAllocate(const MemoryCategory category, const VkDeviceSize size,
+                               const uint32_t memoryTypeIndex) {
+    const uint32_t heapIndex =
+        VulkanContext::get().getPhysicalDevice().getMemoryProperties().memoryTypes[memoryTypeIndex].heapIndex;
+
+    std::lock_guard lock(m_mutex);
+    CategoryStats& stats = m_categories[static_cast<size_t>(category)];
+    stats.liveBytes += size;
+    stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+    ++stats.liveCount;
+    ++stats.totalCount;
+
+    m_heapUsage[heapIndex] += size;
+}
+
+void MemoryTracker::onFree(const MemoryCategory category, const VkDeviceSize size, const uint32_t memoryTypeIndex) {
+    const uint32_t heapIndex =
+        VulkanContext::get().getPhysicalDevice().getMemoryProperties().memoryTypes[memoryTypeIndex].heapIndex;
+
+    std::lock_guard lock(m_mutex);
+    CategoryStats& stats = m_categories[static_cast<size_t>(category)];
+    stats.liveBytes -= size;
+    --stats.liveCount;
+
+    m_heapUsage[heapIndex] -= size;
+}
+
+MemoryTracker::CategoryStats MemoryTracker::getStats(const MemoryCategory category) const {
+    std::lock_guard lock(m_mutex);
+    return m_categories[static_cast<size_t>(category)];
+}
+
+std::vector<MemoryTracker::HeapStats> MemoryTracker::queryHeaps() const {
+    const VulkanContext& vkContext = VulkanContext::get();
+    const VkPhysicalDeviceMemoryProperties& memProperties = vkContext.getPhysicalDevice().getMemoryProperties();
+
+    std::vector<HeapStats> heaps(memProperties.memoryHeapCount);
+    {
+        std::lock_guard lock(m_mutex);
+        for (uint32_t i = 0; i < memProperties.memoryHeapCount; ++i) {
+            heaps[i].size = memProperties.memoryHeaps[i].size;
+            heaps[i].budget = heaps[i].size;
+            heaps[i].usage = m_heapUsage[i];
+            heaps[i].tracked = m_heapUsage[i];
+            heaps[i].isDeviceLocal = memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        }
+    }
+
+    if (!vkContext.hasMemoryBudget()) {
+        return heaps;
+    }
+
+    // Instance is created against 1.0, so the KHR entry point has to be loaded by hand
+    const auto getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+        vkGetInstanceProcAddr(vkContext.getInstance(), "vkGetPhysicalDeviceMemoryProperties2KHR"));
+    if (getMemoryProperties2 == nullptr) {
+        return heaps;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memProperties2{};
+    memProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memProperties2.pNext = &budgetProperties;
+
+    getMemoryProperties2(vkContext.getPhysicalDevice().getUnderlying(), &memProperties2);
+
+    for (uint32_t i = 0; i < heaps.size(); ++i) {
+        heaps[i].budget = budgetProperties.heapBudget[i];
+        heaps[i].usage = budgetProperties.heapUsage[i];
+    }
+
+    return heaps;
+}
+
+std::string MemoryTracker::toJson() const {
+    nlohmann::json report;
+
+    nlohmann::json& categories = report["categories"];
+    for (size_t i = 0; i < m_categories.size(); ++i) {
+        const auto category = static_cast<MemoryCategory>(i);
+        const CategoryStats stats = getStats(category);
+
+        categories[toString(category)] = {
+            { "live_bytes", stats.liveBytes },
+            { "peak_bytes", stats.peakBytes },
+            { "live_count", stats.liveCount },
+            { "total_count", stats.totalCount },
+        };
+    }
+
+    report["heaps"] = nlohmann::json::array();
+    for (const HeapStats& heap : queryHeaps()) {
+        report["heaps"].push_back({
+            { "device_local", heap.isDeviceLocal },
+            { "size", heap.size },
+            { "budget", heap.budget },
+            { "usage", heap.usage },
+            { "tracked", heap.tracked },
+        });
+    }
+
+    report["memory_budget_ext"] = VulkanContext::get().hasMemoryBudget();
+
+    return report.dump(4);
+}
+
+void MemoryTracker::dumpReport(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error(fmt::format("failed to open {}", path));
+    }
+
+    file << toJson();
+    fmt::println("Memory report written to {}", path);
+}
+
+void MemoryTracker::reportLeaks() const {
+    std::lock_guard lock(m_mutex);
+    for (size_t i = 0; i < m_categories.size(); ++i) {
+        const CategoryStats& stats = m_categories[i];
+        if (stats.liveCount == 0) {
+            continue;
+        }
+
+        fmt::println("Leaked GPU memory: {} allocation(s) / {} bytes in {}", stats.liveCount, stats.liveBytes,
+                     toString(static_cast<MemoryCategory>(i)));
+    }
+}
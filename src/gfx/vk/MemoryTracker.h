@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class MemoryCategory {
+    Geometry,
+    Texture,
+    RenderTarget,
+    Staging,
+    Uniform,
+    DrawData,  // Per-object storage buffers, indirect commands
+
+    Count
+};
+
+const char* toString(MemoryCategory category);
+
+// Bookkeeping of every vkAllocateMemory/vkFreeMemory, tagged by category.
+// Heap budgets come from VK_EXT_memory_budget when the device exposes it.
+class MemoryTracker {
+   public:
+    struct CategoryStats {
+        VkDeviceSize liveBytes = 0;
+        VkDeviceSize peakBytes = 0;
+        uint32_t liveCount = 0;
+        uint32_t totalCount = 0;
+    };
+
+    struct HeapStats {
+        VkDeviceSize size = 0;
+        VkDeviceSize budget = 0;  // Heap size when VK_EXT_memory_budget is not available
+        VkDeviceSize usage = 0;   // Process wide usage reported by the driver, ours otherwise
+        VkDeviceSize tracked = 0; // What went through this tracker
+        bool isDeviceLocal = false;
+    };
+
+    static MemoryTracker& get();
+
+    void onAllocate(MemoryCategory category, VkDeviceSize size, uint32_t memoryTypeIndex);
+    void onFree(MemoryCategory category, VkDeviceSize size, uint32_t memoryTypeIndex);
+
+    [[nodiscard]]
+    CategoryStats getStats(MemoryCategory category) const;
+
+    [[nodiscard]]
+    std::vector<HeapStats> queryHeaps() const;
+
+    [[nodiscard]]
+    std::string toJson() const;
+    void dumpReport(const std::string& path) const;
+
+    // Prints every category that still has live allocations, meant to be called right before device destruction
+    void reportLeaks() const;
+
+   private:
+    MemoryTracker() = default;
+
+    mutable std::mutex m_mutex;
+    std::array<CategoryStats, static_cast<size_t>(MemoryCategory::Count)> m_categories{};
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_heapUsage{};
+};
@@ -1,15 +1,21 @@
 #include "OneTimeCommand.h"
 
+#include "DeletionQueue.h"
 #include "types/VulkanContext.h"
 #include "vkutil.h"
 
-OneTimeCommand::OneTimeCommand(const VkQueue& queue) : m_queue(queue) {
+OneTimeCommand::OneTimeCommand(const VkQueue& queue) : OneTimeCommand(queue, VulkanContext::get().getCommandPool()) {
+    m_waitIdle = true;
+}
+
+OneTimeCommand::OneTimeCommand(const VkQueue& queue, const VkCommandPool& commandPool)
+    : m_queue(queue), m_commandPool(commandPool) {
     const VulkanContext& vkContext = VulkanContext::get();
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = vkContext.getCommandPool();
+    allocInfo.commandPool = m_commandPool;
     allocInfo.commandBufferCount = 1;
 
     VK_CHECK("failed to allocate command buffer", vkAllocateCommandBuffers(vkContext.getDevice(), &allocInfo, &buffer));
@@ -22,6 +28,8 @@ OneTimeCommand::OneTimeCommand(const VkQueue& queue) : m_queue(queue) {
 }
 
 OneTimeCommand::~OneTimeCommand() {
+    VulkanContext& vkContext = VulkanContext::get();
+
     VK_CHECK("end command buffer error", vkEndCommandBuffer(buffer));
 
     VkSubmitInfo submitInfo{};
@@ -29,9 +37,29 @@ OneTimeCommand::~OneTimeCommand() {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &buffer;
 
+    if (m_waitIdle) {
+        VK_CHECK("failed to submit queue", vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+        VK_CHECK("failed to wait on queue", vkQueueWaitIdle(m_queue));
+
+        vkFreeCommandBuffers(vkContext.getDevice(), m_commandPool, 1, &buffer);
+        return;
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkSemaphore uploaded;
+    VK_CHECK("failed to create upload semaphore", vkCreateSemaphore(vkContext.getDevice(), &semaphoreInfo, nullptr,
+                                                                    &uploaded));
+
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &uploaded;
+
     VK_CHECK("failed to submit queue", vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
-    VK_CHECK("failed to wait on graphics queue", vkQueueWaitIdle(m_queue));
+    vkContext.enqueueUpload(uploaded);
 
-    const VulkanContext& vkContext = VulkanContext::get();
-    vkFreeCommandBuffers(vkContext.getDevice(), vkContext.getCommandPool(), 1, &buffer);
+    // Retired before the frame that waits on the upload is submitted, so only freed once that frame completes
+    DeletionQueue::get().retire([commandPool = m_commandPool, commandBuffer = buffer] {
+        vkFreeCommandBuffers(VulkanContext::get().getDevice(), commandPool, 1, &commandBuffer);
+    });
 }
@@ -2,13 +2,21 @@
 
 #include <vulkan/vulkan_core.h>
 
+// Command buffer recorded in scope and submitted when it ends
 class OneTimeCommand {
    public:
+    // On the graphics command pool, waits for the submission to complete
     explicit OneTimeCommand(const VkQueue& queue);
+
+    // Uploads: the submission signals a semaphore the next frame waits on (VulkanContext::takeUploadSemaphores),
+    // the command buffer is freed through the DeletionQueue. Nothing waits on the CPU.
+    OneTimeCommand(const VkQueue& queue, const VkCommandPool& commandPool);
     ~OneTimeCommand();
 
     VkCommandBuffer buffer = VK_NULL_HANDLE;
 
    private:
     const VkQueue& m_queue;
+    const VkCommandPool& m_commandPool;
+    bool m_waitIdle = false;
 };
@@ -0,0 +1,85 @@
+#include "ParallelRecorder.h"
+
+#include <algorithm>
+
+#include "types/VulkanContext.h"
+#include "vkutil.h"
+
+ParallelRecorder::ParallelRecorder(ThreadPool& threadPool, const uint32_t framesInFlight)
+    : m_threadPool(threadPool) {
+    const VulkanContext& vkContext = VulkanContext::get();
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = vkContext.getPhysicalDevice().getQueueFamilyIndices().graphicsFamily.value();
+
+    m_frames.resize(framesInFlight, std::vector<WorkerResources>(m_threadPool.getThreadCount()));
+    for (std::vector<WorkerResources>& workers : m_frames) {
+        for (WorkerResources& worker : workers) {
+            VK_CHECK("failed to create worker command pool",
+                     vkCreateCommandPool(vkContext.getDevice(), &poolInfo, nullptr, &worker.commandPool));
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = worker.commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VK_CHECK("failed to allocate secondary command buffer",
+                     vkAllocateCommandBuffers(vkContext.getDevice(), &allocInfo, &worker.commandBuffer));
+        }
+    }
+}
+
+void ParallelRecorder::destroy() const {
+    const VkDevice& device = VulkanContext::get().getDevice();
+
+    for (const std::vector<WorkerResources>& workers : m_frames) {
+        for (const WorkerResources& worker : workers) {
+            vkDestroyCommandPool(device, worker.commandPool, nullptr);
+        }
+    }
+}
+
+std::vector<VkCommandBuffer> ParallelRecorder::record(const uint32_t frameIndex,
+                                                      const VkCommandBufferInheritanceInfo& inheritance,
+                                                      const uint32_t drawCount, const RecordSlice& recordSlice) {
+    std::vector<WorkerResources>& workers = m_frames[frameIndex];
+
+    // Small draw lists use fewer slices, an empty secondary still costs a vkCmdExecuteCommands entry
+    const auto workerCount = static_cast<uint32_t>(workers.size());
+    const uint32_t sliceSize = std::max(1u, (drawCount + workerCount - 1) / workerCount);
+    const uint32_t sliceCount = (drawCount + sliceSize - 1) / sliceSize;
+
+    m_threadPool.run([&](const uint32_t workerIndex) {
+        if (workerIndex >= sliceCount) {
+            return;
+        }
+
+        const WorkerResources& worker = workers[workerIndex];
+        const VkDevice& device = VulkanContext::get().getDevice();
+        VK_CHECK("failed to reset worker command pool", vkResetCommandPool(device, worker.commandPool, 0));
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags =
+            VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+
+        VK_CHECK("failed to begin secondary command buffer", vkBeginCommandBuffer(worker.commandBuffer, &beginInfo));
+
+        const uint32_t begin = workerIndex * sliceSize;
+        const uint32_t end = std::min(begin + sliceSize, drawCount);
+        recordSlice(worker.commandBuffer, begin, end);
+
+        VK_CHECK("failed to record secondary command buffer", vkEndCommandBuffer(worker.commandBuffer));
+    });
+
+    std::vector<VkCommandBuffer> commandBuffers(sliceCount);
+    for (uint32_t i = 0; i < sliceCount; ++i) {
+        commandBuffers[i] = workers[i].commandBuffer;
+    }
+
+    return commandBuffers;
+}
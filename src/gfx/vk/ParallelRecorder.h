@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <functional>
+#include <vector>
+
+#include "common/ThreadPool.h"
+
+// Splits draw recording across a ThreadPool. Every worker owns one VkCommandPool per frame in flight
+// and records its contiguous slice of the draw list into a secondary command buffer.
+class ParallelRecorder {
+   public:
+    using RecordSlice = std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)>;
+
+    ParallelRecorder(ThreadPool& threadPool, uint32_t framesInFlight);
+
+    void destroy() const;
+
+    // Must be called once the frame's fence is signaled, the frame's pools are reset.
+    // Returns the recorded secondaries, in draw list order, ready for vkCmdExecuteCommands.
+    [[nodiscard]]
+    std::vector<VkCommandBuffer> record(uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance,
+                                        uint32_t drawCount, const RecordSlice& recordSlice);
+
+   private:
+    struct WorkerResources {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    ThreadPool& m_threadPool;
+    std::vector<std::vector<WorkerResources>> m_frames;  // [frame][worker]
+};
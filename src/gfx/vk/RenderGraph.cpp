@@ -0,0 +1,513 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+
+#include "DeletionQueue.h"
+#include "MemoryTracker.h"
+#include "types/VulkanContext.h"
+#include "vkutil.h"
+
+namespace {
+struct UsageInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags readAccess;
+    VkAccessFlags writeAccess;
+    VkImageLayout layout;
+    VkImageUsageFlags imageUsage;
+};
+
+UsageInfo getUsageInfo(const RenderGraph::Usage usage, const VkImageAspectFlags aspect, const bool isWrite) {
+    const VkImageLayout sampledLayout = aspect & VK_IMAGE_ASPECT_DEPTH_BIT
+                                            ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                            : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    switch (usage) {
+        case RenderGraph::Usage::ColorAttachment:
+            return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+                     VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+        case RenderGraph::Usage::DepthAttachment:
+            return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                     isWrite ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                             : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+        case RenderGraph::Usage::ComputeSampled:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, sampledLayout,
+                     VK_IMAGE_USAGE_SAMPLED_BIT };
+        case RenderGraph::Usage::FragmentSampled:
+            return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, sampledLayout,
+                     VK_IMAGE_USAGE_SAMPLED_BIT };
+        case RenderGraph::Usage::ComputeGeneral:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                     VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+        case RenderGraph::Usage::IndirectBuffer:
+            return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0,
+                     VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+        case RenderGraph::Usage::Transfer:
+            return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     isWrite ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     isWrite ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+        case RenderGraph::Usage::Present:
+            return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0 };
+    }
+
+    throw std::invalid_argument("unknown render graph usage");
+}
+
+std::optional<uint32_t> findMemoryType(const uint32_t typeBits, const VkMemoryPropertyFlags properties) {
+    const VkPhysicalDeviceMemoryProperties& memoryProperties =
+        VulkanContext::get().getPhysicalDevice().getMemoryProperties();
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+        if (typeBits & (1 << i) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+constexpr VkImageUsageFlags attachmentUsages = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                               VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                               VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+}  // namespace
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, const uint32_t passIndex)
+    : m_graph(graph), m_passIndex(passIndex) {}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(const ResourceID resource, const Usage usage) {
+    m_graph.m_addAccess(m_passIndex, resource, usage, false);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(const ResourceID resource, const Usage usage) {
+    m_graph.m_addAccess(m_passIndex, resource, usage, true);
+    return *this;
+}
+
+void RenderGraph::destroy() {
+    m_releaseTransients();
+    reset();
+}
+
+void RenderGraph::reset() {
+    m_resources.clear();
+    m_passes.clear();
+    m_culledPassCount = 0;
+}
+
+RenderGraph::ResourceID RenderGraph::importImage(std::string name, const VkImage image, const VkImageView view,
+                                                 const VkImageAspectFlags aspect, const uint32_t mipLevels,
+                                                 ResourceState& state) {
+    Resource& resource = m_resources.emplace_back();
+    resource.name = std::move(name);
+    resource.image = image;
+    resource.view = view;
+    resource.aspect = aspect;
+    resource.mipLevels = mipLevels;
+    resource.importedState = &state;
+
+    return m_resources.size() - 1;
+}
+
+RenderGraph::ResourceID RenderGraph::importBuffer(std::string name, const VkBuffer buffer, ResourceState& state) {
+    Resource& resource = m_resources.emplace_back();
+    resource.name = std::move(name);
+    resource.isImage = false;
+    resource.buffer = buffer;
+    resource.importedState = &state;
+
+    return m_resources.size() - 1;
+}
+
+RenderGraph::ResourceID RenderGraph::createImage(std::string name, const ImageDesc& desc) {
+    Resource& resource = m_resources.emplace_back();
+    resource.name = std::move(name);
+    resource.isImported = false;
+    resource.aspect = desc.aspect;
+    resource.mipLevels = desc.mipLevels;
+    resource.desc = desc;
+
+    return m_resources.size() - 1;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(std::string name, Execute execute) {
+    m_passes.push_back({ .name = std::move(name), .execute = std::move(execute) });
+    return { *this, static_cast<uint32_t>(m_passes.size() - 1) };
+}
+
+void RenderGraph::markOutput(const ResourceID resource, const Usage usage) {
+    m_resources[resource].isOutput = true;
+    m_resources[resource].outputUsage = usage;
+}
+
+void RenderGraph::compile() {
+    m_cullPasses();
+
+    // Transient lifetimes and usages, only accounting for the passes that survived
+    for (int32_t i = 0; i < m_passes.size(); ++i) {
+        if (m_passes[i].isCulled) {
+            continue;
+        }
+
+        for (const Access& access : m_passes[i].accesses) {
+            Resource& resource = m_resources[access.resource];
+            if (resource.isImported) {
+                continue;
+            }
+
+            if (resource.firstPass < 0) {
+                resource.firstPass = i;
+            }
+            resource.lastPass = i;
+            resource.usage |= getUsageInfo(access.usage, resource.aspect, access.isWrite).imageUsage;
+        }
+    }
+
+    for (Resource& resource : m_resources) {
+        if (!resource.isImported && resource.isOutput) {
+            resource.usage |= getUsageInfo(resource.outputUsage, resource.aspect, false).imageUsage;
+        }
+    }
+
+    m_allocateTransients();
+}
+
+void RenderGraph::execute(const VkCommandBuffer& commandBuffer) {
+    for (Resource& resource : m_resources) {
+        if (resource.isImported) {
+            resource.state = *resource.importedState;
+        }
+    }
+
+    for (int32_t i = 0; i < m_passes.size(); ++i) {
+        const Pass& pass = m_passes[i];
+        if (pass.isCulled) {
+            continue;
+        }
+
+        for (const Access& access : pass.accesses) {
+            Resource& resource = m_resources[access.resource];
+
+            // The first use of a transient discards whatever the previous occupant of its memory left
+            if (!resource.isImported && resource.firstPass == i) {
+                const MemoryBlock& block = m_blocks[m_transients[resource.transientIndex].block];
+                resource.state = block.lastUse;
+                resource.state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+
+            m_transition(resource, access.usage, access.isWrite);
+        }
+
+        m_flushBarriers(commandBuffer);
+        pass.execute(commandBuffer, *this);
+
+        for (const Access& access : pass.accesses) {
+            const Resource& resource = m_resources[access.resource];
+            if (!resource.isImported && resource.lastPass == i) {
+                m_blocks[m_transients[resource.transientIndex].block].lastUse = resource.state;
+            }
+        }
+    }
+
+    for (Resource& resource : m_resources) {
+        if (resource.isOutput && (resource.isImported || resource.transientIndex >= 0)) {
+            m_transition(resource, resource.outputUsage, false);
+        }
+    }
+    m_flushBarriers(commandBuffer);
+
+    for (const Resource& resource : m_resources) {
+        if (resource.isImported) {
+            *resource.importedState = resource.state;
+        }
+    }
+}
+
+VkImage RenderGraph::getImage(const ResourceID resource) const {
+    const Resource& res = m_resources[resource];
+    if (res.isImported || res.transientIndex < 0) {
+        return res.image;
+    }
+
+    return m_transients[res.transientIndex].image;
+}
+
+VkImageView RenderGraph::getImageView(const ResourceID resource) const {
+    const Resource& res = m_resources[resource];
+    if (res.isImported || res.transientIndex < 0) {
+        return res.view;
+    }
+
+    return m_transients[res.transientIndex].view;
+}
+
+VkBuffer RenderGraph::getBuffer(const ResourceID resource) const {
+    return m_resources[resource].buffer;
+}
+
+uint32_t RenderGraph::getCulledPassCount() const {
+    return m_culledPassCount;
+}
+
+void RenderGraph::m_addAccess(const uint32_t passIndex, const ResourceID resource, const Usage usage,
+                              const bool isWrite) {
+    const UsageInfo info = getUsageInfo(usage, m_resources[resource].aspect, isWrite);
+    if (isWrite && info.writeAccess == 0) {
+        throw std::invalid_argument("render graph: usage is read only, " + m_resources[resource].name + " written by " +
+                                    m_passes[passIndex].name);
+    }
+
+    m_passes[passIndex].accesses.push_back({ resource, usage, isWrite });
+}
+
+void RenderGraph::m_cullPasses() {
+    // Walking backward, a pass is kept when it writes something that is needed later: an imported resource,
+    // an output, or a resource read by a kept pass
+    std::vector<bool> isNeeded(m_resources.size());
+    for (uint32_t i = 0; i < m_resources.size(); ++i) {
+        isNeeded[i] = m_resources[i].isImported || m_resources[i].isOutput;
+    }
+
+    for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+        pass->isCulled = std::ranges::none_of(pass->accesses, [&isNeeded](const Access& access) {
+            return access.isWrite && isNeeded[access.resource];
+        });
+
+        if (pass->isCulled) {
+            ++m_culledPassCount;
+            continue;
+        }
+
+        for (const Access& access : pass->accesses) {
+            isNeeded[access.resource] = true;
+        }
+    }
+}
+
+void RenderGraph::m_allocateTransients() {
+    std::vector<TransientImage> wanted;
+    for (Resource& resource : m_resources) {
+        if (resource.isImported || resource.firstPass < 0) {
+            continue;
+        }
+
+        resource.transientIndex = wanted.size();
+        wanted.push_back({ resource.desc, resource.usage, resource.firstPass, resource.lastPass });
+    }
+
+    // Same shape as last frame: the images and their placement can be reused
+    const bool isSameShape = std::ranges::equal(wanted, m_transients, [](const TransientImage& a,
+                                                                          const TransientImage& b) {
+        return a.desc == b.desc && a.usage == b.usage && a.firstPass == b.firstPass && a.lastPass == b.lastPass;
+    });
+    if (isSameShape) {
+        return;
+    }
+
+    m_releaseTransients();
+    m_transients = std::move(wanted);
+
+    const VkDevice& device = VulkanContext::get().getDevice();
+
+    std::vector<VkMemoryRequirements> requirements(m_transients.size());
+    std::vector<bool> isLazy(m_transients.size());
+    for (uint32_t i = 0; i < m_transients.size(); ++i) {
+        TransientImage& transient = m_transients[i];
+
+        // Attachment only images can live in tile memory and never be backed on tilers
+        isLazy[i] = (transient.usage & ~attachmentUsages) == 0;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { transient.desc.width, transient.desc.height, 1 };
+        imageInfo.mipLevels = transient.desc.mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = transient.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = transient.usage | (isLazy[i] ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VK_CHECK("failed to create transient image", vkCreateImage(device, &imageInfo, nullptr, &transient.image));
+        vkGetImageMemoryRequirements(device, transient.image, &requirements[i]);
+    }
+
+    // Largest first so that each block is sized by its first occupant
+    std::vector<uint32_t> order(m_transients.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, [&requirements](const uint32_t a, const uint32_t b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    for (const uint32_t i : order) {
+        TransientImage& transient = m_transients[i];
+        const VkMemoryRequirements& req = requirements[i];
+
+        if (isLazy[i]) {
+            const std::optional<uint32_t> lazyType =
+                findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+            if (lazyType.has_value()) {
+                transient.block = m_blocks.size();
+                m_blocks.push_back({ .size = req.size, .memoryTypeIndex = lazyType.value(), .isLazy = true });
+                continue;
+            }
+        }
+
+        const auto fits = [&](const MemoryBlock& block) {
+            if (block.isLazy || block.size < req.size || !(req.memoryTypeBits & (1 << block.memoryTypeIndex))) {
+                return false;
+            }
+
+            return std::ranges::none_of(block.lifetimes, [&transient](const std::pair<int32_t, int32_t>& lifetime) {
+                return transient.firstPass <= lifetime.second && lifetime.first <= transient.lastPass;
+            });
+        };
+
+        const auto block = std::ranges::find_if(m_blocks, fits);
+        if (block != m_blocks.end()) {
+            transient.block = block - m_blocks.begin();
+        } else {
+            const std::optional<uint32_t> memoryType =
+                findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (!memoryType.has_value()) {
+                throw std::runtime_error("no memory type for transient image!");
+            }
+
+            transient.block = m_blocks.size();
+            m_blocks.push_back({ .size = req.size, .memoryTypeIndex = memoryType.value() });
+        }
+
+        m_blocks[transient.block].lifetimes.emplace_back(transient.firstPass, transient.lastPass);
+    }
+
+    for (MemoryBlock& block : m_blocks) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = block.memoryTypeIndex;
+
+        VK_CHECK("failed to allocate transient memory", vkAllocateMemory(device, &allocInfo, nullptr, &block.memory));
+        MemoryTracker::get().onAllocate(MemoryCategory::RenderTarget, block.size, block.memoryTypeIndex);
+    }
+
+    for (TransientImage& transient : m_transients) {
+        vkBindImageMemory(device, transient.image, m_blocks[transient.block].memory, 0);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = transient.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = transient.desc.format;
+        viewInfo.subresourceRange.aspectMask = transient.desc.aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = transient.desc.mipLevels;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VK_CHECK("failed to create transient image view",
+                 vkCreateImageView(device, &viewInfo, nullptr, &transient.view));
+    }
+}
+
+void RenderGraph::m_releaseTransients() {
+    if (m_transients.empty()) {
+        return;
+    }
+
+    DeletionQueue::get().retire([transients = std::move(m_transients), blocks = std::move(m_blocks)] {
+        const VkDevice& device = VulkanContext::get().getDevice();
+
+        for (const TransientImage& transient : transients) {
+            vkDestroyImageView(device, transient.view, nullptr);
+            vkDestroyImage(device, transient.image, nullptr);
+        }
+
+        for (const MemoryBlock& block : blocks) {
+            vkFreeMemory(device, block.memory, nullptr);
+            MemoryTracker::get().onFree(MemoryCategory::RenderTarget, block.size, block.memoryTypeIndex);
+        }
+    });
+
+    m_transients.clear();
+    m_blocks.clear();
+}
+
+void RenderGraph::m_transition(Resource& resource, const Usage usage, const bool isWrite) {
+    const UsageInfo info = getUsageInfo(usage, resource.aspect, isWrite);
+    const VkAccessFlags access = info.readAccess | (isWrite ? info.writeAccess : 0);
+
+    ResourceState& state = resource.state;
+    const bool isLayoutChange = resource.isImage && state.layout != info.layout;
+
+    VkPipelineStageFlags srcStages;
+    bool needsBarrier;
+    if (isWrite || isLayoutChange) {
+        // Waits on the last write and, write after read, on every read since
+        srcStages = state.writeStages | state.readStages;
+        needsBarrier = isLayoutChange || srcStages != 0;
+    } else {
+        // Read after read: only the stages that haven't been synchronized with the last write yet
+        srcStages = state.writeStages;
+        needsBarrier = srcStages != 0 && (info.stages & ~state.readStages) != 0;
+    }
+
+    if (needsBarrier) {
+        m_pendingSrcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        m_pendingDstStages |= info.stages;
+
+        // Execution dependencies alone don't need a barrier structure
+        if (resource.isImage && (isLayoutChange || state.writeAccess != 0)) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = state.writeAccess;
+            barrier.dstAccessMask = access;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = info.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = resource.isImported ? resource.image : m_transients[resource.transientIndex].image;
+            barrier.subresourceRange = { resource.aspect, 0, resource.mipLevels, 0, 1 };
+
+            m_pendingImageBarriers.push_back(barrier);
+        } else if (!resource.isImage && state.writeAccess != 0) {
+            m_pendingSrcAccess |= state.writeAccess;
+            m_pendingDstAccess |= access;
+        }
+    }
+
+    if (isWrite || isLayoutChange) {
+        state.layout = resource.isImage ? info.layout : state.layout;
+        state.writeStages = info.stages;
+        state.writeAccess = isWrite ? info.writeAccess : 0;
+        state.readStages = isWrite ? 0 : info.stages;
+    } else {
+        state.readStages |= info.stages;
+    }
+}
+
+void RenderGraph::m_flushBarriers(const VkCommandBuffer& commandBuffer) {
+    if (m_pendingDstStages == 0) {
+        return;
+    }
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = m_pendingSrcAccess;
+    memoryBarrier.dstAccessMask = m_pendingDstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, m_pendingSrcStages, m_pendingDstStages, 0, m_pendingSrcAccess != 0 ? 1 : 0,
+                         &memoryBarrier, 0, nullptr, m_pendingImageBarriers.size(), m_pendingImageBarriers.data());
+
+    m_pendingSrcStages = 0;
+    m_pendingDstStages = 0;
+    m_pendingSrcAccess = 0;
+    m_pendingDstAccess = 0;
+    m_pendingImageBarriers.clear();
+}
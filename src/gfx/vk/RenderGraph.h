@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Frame graph: passes declare which resources they read and write, the graph culls the passes whose results are
+// never used, derives the pipeline barriers (batched into one vkCmdPipelineBarrier per pass) and places transient
+// images into shared, aliased memory. Rebuilt every frame: reset(), import/create, addPass(), compile(), execute().
+class RenderGraph {
+   public:
+    typedef uint32_t ResourceID;
+
+    // How a pass touches a resource, i.e. its stages, access masks and image layout
+    enum class Usage {
+        ColorAttachment,
+        DepthAttachment,
+        ComputeSampled,   // SHADER_READ_ONLY_OPTIMAL, DEPTH_STENCIL_READ_ONLY_OPTIMAL for depth
+        FragmentSampled,  // Same as ComputeSampled
+        ComputeGeneral,   // Storage images and buffers, or images sampled in GENERAL layout
+        IndirectBuffer,
+        Transfer,
+        Present,
+    };
+
+    // Synchronization state of a resource. Imported resources keep theirs across frames.
+    struct ResourceState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;  // Last write, layout transitions included
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;  // Reads since the last write, already synchronized with it
+    };
+
+    // Transient images are owned by the graph, their content doesn't survive the frame
+    struct ImageDesc {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        uint32_t mipLevels = 1;
+
+        bool operator==(const ImageDesc&) const = default;
+    };
+
+    using Execute = std::function<void(const VkCommandBuffer& commandBuffer, const RenderGraph& graph)>;
+
+    class PassBuilder {
+       public:
+        PassBuilder& read(ResourceID resource, Usage usage);
+        PassBuilder& write(ResourceID resource, Usage usage);
+
+       private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, uint32_t passIndex);
+
+        RenderGraph& m_graph;
+        uint32_t m_passIndex;
+    };
+
+    RenderGraph() = default;
+
+    // Transient memory is retired through the DeletionQueue
+    void destroy();
+
+    // Drops passes and resources, transient memory is kept for the next compile()
+    void reset();
+
+    // `state` is read when the graph executes and updated with where the resource was left
+    ResourceID importImage(std::string name, VkImage image, VkImageView view, VkImageAspectFlags aspect,
+                           uint32_t mipLevels, ResourceState& state);
+    ResourceID importBuffer(std::string name, VkBuffer buffer, ResourceState& state);
+
+    // Usage flags are derived from the declared uses. Images only used as attachments are lazily allocated
+    // when the device supports it, they must then be neither loaded nor stored.
+    ResourceID createImage(std::string name, const ImageDesc& desc);
+
+    PassBuilder addPass(std::string name, Execute execute);
+
+    // The resource leaves the graph in `usage`, e.g. Present for the swap chain image.
+    // Writes to imported resources are always kept, outputs only matter for transient ones.
+    void markOutput(ResourceID resource, Usage usage);
+
+    // Culls unused passes and allocates transient images
+    void compile();
+
+    void execute(const VkCommandBuffer& commandBuffer);
+
+    [[nodiscard]]
+    VkImage getImage(ResourceID resource) const;
+
+    [[nodiscard]]
+    VkImageView getImageView(ResourceID resource) const;
+
+    [[nodiscard]]
+    VkBuffer getBuffer(ResourceID resource) const;
+
+    [[nodiscard]]
+    uint32_t getCulledPassCount() const;
+
+   private:
+    struct Resource {
+        std::string name;
+        bool isImage = true;
+        bool isImported = true;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        uint32_t mipLevels = 1;
+
+        ResourceState* importedState = nullptr;
+        ResourceState state;  // Working copy while executing
+
+        // Transient only
+        ImageDesc desc;
+        VkImageUsageFlags usage = 0;
+        int32_t firstPass = -1;
+        int32_t lastPass = -1;
+        int32_t transientIndex = -1;  // In m_transients
+
+        bool isOutput = false;
+        Usage outputUsage = Usage::Present;
+    };
+
+    struct Access {
+        ResourceID resource;
+        Usage usage;
+        bool isWrite;
+    };
+
+    struct Pass {
+        std::string name;
+        Execute execute;
+        std::vector<Access> accesses;
+        bool isCulled = false;
+    };
+
+    // Memory shared by transient images whose lifetimes don't overlap. Lazily allocated images get their own.
+    struct MemoryBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        bool isLazy = false;
+        std::vector<std::pair<int32_t, int32_t>> lifetimes;  // [firstPass, lastPass] of each occupant
+
+        // Last use of the block, the next occupant's first use waits on it (carried across frames)
+        ResourceState lastUse;
+    };
+
+    // Physical image backing a transient resource, reused while the graph keeps the same shape
+    struct TransientImage {
+        ImageDesc desc;
+        VkImageUsageFlags usage = 0;
+        int32_t firstPass = -1;
+        int32_t lastPass = -1;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t block = 0;  // In m_blocks
+    };
+
+    void m_addAccess(uint32_t passIndex, ResourceID resource, Usage usage, bool isWrite);
+    void m_cullPasses();
+    void m_allocateTransients();
+    void m_releaseTransients();
+
+    // Appends what `usage` needs to the pending barriers and updates the resource state
+    void m_transition(Resource& resource, Usage usage, bool isWrite);
+    void m_flushBarriers(const VkCommandBuffer& commandBuffer);
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    uint32_t m_culledPassCount = 0;
+
+    std::vector<TransientImage> m_transients;
+    std::vector<MemoryBlock> m_blocks;
+
+    // Batched barriers of the pass being executed
+    VkPipelineStageFlags m_pendingSrcStages = 0;
+    VkPipelineStageFlags m_pendingDstStages = 0;
+    VkAccessFlags m_pendingSrcAccess = 0;  // Buffers, as a single global memory barrier
+    VkAccessFlags m_pendingDstAccess = 0;
+    std::vector<VkImageMemoryBarrier> m_pendingImageBarriers;
+};
@@ -0,0 +1,188 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#include "types/VulkanContext.h"
+
+constexpr uint32_t depthBits = 20;
+constexpr uint32_t meshShift = depthBits;
+constexpr uint32_t materialShift = meshShift + 16;
+constexpr uint32_t pipelineShift = materialShift + 16;
+constexpr uint32_t passShift = pipelineShift + 8;
+
+RenderQueue::RenderQueue() {
+    const VulkanContext& vkContext = VulkanContext::get();
+    if (vkContext.hasDrawIndirectCount()) {
+        m_cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(vkContext.getDevice(), "vkCmdDrawIndexedIndirectCountKHR"));
+    }
+}
+
+void RenderQueue::reset(LinearAllocator& allocator, const uint32_t capacity) {
+    m_allocator = &allocator;
+    m_items = allocator.allocate<RenderItem>(capacity);
+    m_keys = allocator.allocate<uint64_t>(capacity);
+    m_order = allocator.allocate<uint32_t>(capacity);
+    m_pipelines = allocator.allocate<const Pipeline*>(maxPipelines);
+
+    m_size = 0;
+    m_capacity = capacity;
+    m_pipelineCount = 0;
+}
+
+void RenderQueue::push(const RenderItem& item, const SortKey& sortKey) {
+    if (m_size == m_capacity) {
+        throw std::runtime_error("render queue is full");
+    }
+
+    // Non negative floats sort like their bit pattern, the top bits are a coarse depth
+    const float depth = std::max(sortKey.depth, 0.0f);
+    const uint64_t depthKey = std::bit_cast<uint32_t>(depth) >> (31 - depthBits);
+
+    m_keys[m_size] = static_cast<uint64_t>(sortKey.pass) << passShift |
+                     static_cast<uint64_t>(m_getPipelineKey(item.pipeline)) << pipelineShift |
+                     static_cast<uint64_t>(sortKey.material & 0xFFFF) << materialShift |
+                     static_cast<uint64_t>(sortKey.mesh & 0xFFFF) << meshShift | depthKey;
+    m_items[m_size] = item;
+    m_order[m_size] = m_size;
+    ++m_size;
+}
+
+void RenderQueue::sort() {
+    if (m_size < 2) {
+        return;
+    }
+
+    // LSD radix sort, 8 bits per pass. Stable, so equal keys keep their submission order
+    uint64_t* keys = m_keys;
+    uint32_t* order = m_order;
+    uint64_t* keysTmp = m_allocator->allocate<uint64_t>(m_size);
+    uint32_t* orderTmp = m_allocator->allocate<uint32_t>(m_size);
+
+    // Every histogram in a single sweep
+    uint32_t histograms[8][256]{};
+    for (uint32_t i = 0; i < m_size; ++i) {
+        for (uint32_t pass = 0; pass < 8; ++pass) {
+            ++histograms[pass][(keys[i] >> (pass * 8)) & 0xFF];
+        }
+    }
+
+    for (uint32_t pass = 0; pass < 8; ++pass) {
+        uint32_t* histogram = histograms[pass];
+
+        // All keys share this byte: the pass would be a copy
+        if (histogram[(keys[0] >> (pass * 8)) & 0xFF] == m_size) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; ++bucket) {
+            const uint32_t count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += count;
+        }
+
+        for (uint32_t i = 0; i < m_size; ++i) {
+            const uint32_t destination = histogram[(keys[i] >> (pass * 8)) & 0xFF]++;
+            keysTmp[destination] = keys[i];
+            orderTmp[destination] = order[i];
+        }
+
+        std::swap(keys, keysTmp);
+        std::swap(order, orderTmp);
+    }
+
+    if (order != m_order) {
+        std::memcpy(m_keys, keys, sizeof(uint64_t) * m_size);
+        std::memcpy(m_order, order, sizeof(uint32_t) * m_size);
+    }
+}
+
+uint32_t RenderQueue::size() const {
+    return m_size;
+}
+
+void RenderQueue::record(const VkCommandBuffer& commandBuffer, const uint32_t begin, const uint32_t end,
+                         const VkPipelineLayout& pipelineLayout, const VkDescriptorSet& sceneSet,
+                         const uint32_t sceneDynamicOffset) const {
+    // Every pipeline shares the same layout, so bound sets stay valid across pipeline changes
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &sceneSet, 1,
+                            &sceneDynamicOffset);
+
+    const Pipeline* boundPipeline = nullptr;
+    VkDescriptorSet boundMaterialSet = VK_NULL_HANDLE;
+    VkDescriptorSet boundObjectSet = VK_NULL_HANDLE;
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+
+    for (uint32_t i = begin; i < end; ++i) {
+        const RenderItem& item = m_items[m_order[i]];
+
+        if (item.pipeline != boundPipeline) {
+            item.pipeline->bind(commandBuffer);
+            boundPipeline = item.pipeline;
+        }
+
+        if (item.materialSet != boundMaterialSet) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1,
+                                    &item.materialSet, 0, nullptr);
+            boundMaterialSet = item.materialSet;
+        }
+
+        if (item.objectSet != VK_NULL_HANDLE && item.objectSet != boundObjectSet) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 2, 1,
+                                    &item.objectSet, 0, nullptr);
+            boundObjectSet = item.objectSet;
+        }
+
+        if (item.vertexBuffer != boundVertexBuffer) {
+            constexpr VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &item.vertexBuffer, &offset);
+            boundVertexBuffer = item.vertexBuffer;
+        }
+
+        if (item.indexBuffer != boundIndexBuffer) {
+            vkCmdBindIndexBuffer(commandBuffer, item.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+            boundIndexBuffer = item.indexBuffer;
+        }
+
+        if (item.pushConstants != nullptr) {
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, item.pushConstantsSize,
+                               item.pushConstants);
+        }
+
+        switch (item.drawType) {
+            case RenderItem::DrawType::Indexed:
+                vkCmdDrawIndexed(commandBuffer, item.indexed.indexCount, item.indexed.instanceCount,
+                                 item.indexed.firstIndex, item.indexed.vertexOffset, item.indexed.firstInstance);
+                break;
+            case RenderItem::DrawType::IndexedIndirect:
+                vkCmdDrawIndexedIndirect(commandBuffer, item.indirect.buffer, item.indirect.offset,
+                                         item.indirect.maxDrawCount, item.indirect.stride);
+                break;
+            case RenderItem::DrawType::IndexedIndirectCount:
+                m_cmdDrawIndexedIndirectCount(commandBuffer, item.indirect.buffer, item.indirect.offset,
+                                              item.indirect.countBuffer, item.indirect.countOffset,
+                                              item.indirect.maxDrawCount, item.indirect.stride);
+                break;
+        }
+    }
+}
+
+uint32_t RenderQueue::m_getPipelineKey(const Pipeline* pipeline) {
+    for (uint32_t i = 0; i < m_pipelineCount; ++i) {
+        if (m_pipelines[i] == pipeline) {
+            return i;
+        }
+    }
+
+    if (m_pipelineCount == maxPipelines) {
+        throw std::runtime_error("render queue: too many pipelines");
+    }
+
+    m_pipelines[m_pipelineCount] = pipeline;
+    return m_pipelineCount++;
+}
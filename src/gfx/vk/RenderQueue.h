@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <functional>
+
+#include "common/LinearAllocator.h"
+#include "pipeline/Pipeline.h"
+#include "types/SceneSpecialization.h"
+
+// Everything needed to record one draw, binds included
+struct RenderItem {
+    enum class DrawType : uint8_t { Indexed, IndexedIndirect, IndexedIndirectCount };
+
+    const Pipeline* pipeline = nullptr;
+    VkDescriptorSet materialSet = VK_NULL_HANDLE;  // Set 1
+    VkDescriptorSet objectSet = VK_NULL_HANDLE;    // Set 2, optional
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+
+    // Vertex stage push constants, optional. Must outlive the recording (e.g. frame allocator memory)
+    const void* pushConstants = nullptr;
+    uint32_t pushConstantsSize = 0;
+
+    DrawType drawType = DrawType::Indexed;
+
+    struct Indexed {
+        uint32_t indexCount = 0;
+        uint32_t instanceCount = 1;
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+        uint32_t firstInstance = 0;
+    } indexed;
+
+    struct Indirect {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkBuffer countBuffer = VK_NULL_HANDLE;  // IndexedIndirectCount only
+        VkDeviceSize countOffset = 0;
+        uint32_t maxDrawCount = 0;
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    } indirect;
+};
+
+// Scene pipeline of a material permutation, nullptr when it isn't built yet (the draw is skipped)
+using ScenePipelineResolver = std::function<const Pipeline*(MaterialFeatures features)>;
+
+// Per-frame list of draws, sorted on a 64-bit key and recorded without redundant binds.
+// Key, MSB first: pass (4) | pipeline (8) | material (16) | mesh (16) | depth (20)
+class RenderQueue {
+   public:
+    enum class Pass : uint8_t { Background, Opaque };
+
+    struct SortKey {
+        Pass pass = Pass::Opaque;
+        uint32_t material = 0;  // Only the low 16 bits are kept
+        uint32_t mesh = 0;      // Only the low 16 bits are kept
+        float depth = 0.0f;     // View distance, front to back
+    };
+
+    RenderQueue();
+
+    // Storage comes from the frame allocator, which must not be reset before recording is done
+    void reset(LinearAllocator& allocator, uint32_t capacity);
+
+    void push(const RenderItem& item, const SortKey& sortKey);
+
+    void sort();
+
+    [[nodiscard]]
+    uint32_t size() const;
+
+    // Records sorted items [begin, end). Thread safe: slices can be recorded in parallel.
+    // The scene set (0) is bound once, everything else only when it changes.
+    void record(const VkCommandBuffer& commandBuffer, uint32_t begin, uint32_t end,
+                const VkPipelineLayout& pipelineLayout, const VkDescriptorSet& sceneSet,
+                uint32_t sceneDynamicOffset) const;
+
+   private:
+    LinearAllocator* m_allocator = nullptr;
+
+    RenderItem* m_items = nullptr;
+    uint64_t* m_keys = nullptr;
+    uint32_t* m_order = nullptr;  // Sorted indices in m_items
+    uint32_t m_size = 0;
+    uint32_t m_capacity = 0;
+
+    // Pipelines get a small key in the order they are first pushed
+    static constexpr uint32_t maxPipelines = 256;
+    const Pipeline** m_pipelines = nullptr;
+    uint32_t m_pipelineCount = 0;
+
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
+
+    [[nodiscard]]
+    uint32_t m_getPipelineKey(const Pipeline* pipeline);
+};
@@ -11,22 +11,82 @@
 #include <stdexcept>
 #include <thread>
 
+#include "DeletionQueue.h"
+#include "common/Frustum.h"
+#include "MemoryTracker.h"
+#include "gpu_resources/GeometryArena.h"
 #include "gpu_resources/Shader.h"
+#include "gpu_resources/ShaderCache.h"
 #include "input/Keyboard.h"
 #include "input/Mouse.h"
 #include "objects/prefabs/Cube.h"
 #include "objects/prefabs/Plane.h"
+#include "pipeline/PipelineCache.h"
+#include "pipeline/PipelineManager.h"
+#include "pipeline/PipelineReloader.h"
 #include "types/ModelConstants.h"
 #include "types/Vertex.h"
 #include "vkutil.h"
 
-constexpr uint32_t maxInflightFrames = 1;
+// Shared geometry pool sizes, in elements
+constexpr uint32_t geometryArenaVertexCapacity = 1 << 20;
+constexpr uint32_t geometryArenaIndexCapacity = 1 << 22;
+
+// Written at shutdown, reused on the next launch when the device and driver are unchanged
+constexpr const char* pipelineCachePath = "pipeline_cache.bin";
+constexpr const char* shaderCacheDirectory = "shader_cache";
+
+// Pipeline variants are compiled and created on these, off the render thread
+constexpr uint32_t pipelineBuildThreads = 2;
+
+constexpr PipelineManager::Key skyboxPipelineKey = 1;
+
+// Scene pipelines are keyed by their material features, the generic one stands in while others build
+constexpr PipelineManager::Key scenePipelineFamily = uint64_t{ 1 } << 32;
+constexpr MaterialFeatures genericMaterialFeatures = MaterialFeature::BaseColorTexture;
+
+constexpr PipelineManager::Key getScenePipelineKey(const MaterialFeatures features) {
+    return scenePipelineFamily | features;
+}
+
+constexpr double defaultFrameRateLimit = 60.0;
+constexpr auto frameStatsReportInterval = std::chrono::seconds(1);
+
+constexpr std::array cycledPresentModes = {
+    VK_PRESENT_MODE_FIFO_KHR,
+    VK_PRESENT_MODE_MAILBOX_KHR,
+    VK_PRESENT_MODE_IMMEDIATE_KHR,
+};
+
+constexpr uint32_t maxRecordingThreads = 4;
+
+// GPU driven path capacities: meshes and distinct materials per frame
+constexpr uint32_t maxIndirectObjects = 16384;
+constexpr uint32_t maxIndirectMaterials = 256;
+
+// CPU path capacity: visible mesh instances per frame
+constexpr uint32_t maxInstances = 16384;
+
+// Render queue worst case: a draw per instance or indirect object, plus the background (skybox) ones
+constexpr uint32_t maxBackgroundDraws = 64;
+constexpr size_t maxRenderQueueItems = std::max(maxInstances, maxIndirectObjects) + maxBackgroundDraws;
+
+// Item, key and order index, plus the radix sort's scratch key and index
+constexpr size_t renderQueueItemSize = sizeof(RenderItem) + sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2;
+
+// Per-frame CPU scratch memory: the render queue at full capacity, then push constants and alignment slack
+constexpr size_t frameAllocatorSize = maxRenderQueueItems * renderQueueItemSize + 64 * 1024;
+
+// Transient uniform data budget, per frame in flight
+constexpr VkDeviceSize uniformRingFrameSize = 256 * 1024;
 
 const std::vector requiredVKExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 };
 
-VK::VK(SDL_Window* window) {
+VK::VK(SDL_Window* window, const uint32_t framesInFlight)
+    : m_framesInFlight(std::clamp(framesInFlight, 1u, maxFramesInFlight)), m_frameLimiter(defaultFrameRateLimit),
+      m_frameAllocator(frameAllocatorSize) {
     Keyboard::init();
     m_window = window;
 }
@@ -37,6 +97,20 @@ void VK::run() {
     m_destroyVulkan();
 }
 
+void VK::setPresentMode(const VkPresentModeKHR presentMode) {
+    m_requestedPresentMode = presentMode;
+    m_swapChainDirty = true;
+}
+
+void VK::setFrameRateLimit(const double fps) {
+    m_frameLimiter.setTargetFps(fps);
+    fmt::println("Frame rate limit: {}", fps > 0.0 ? fmt::format("{} fps", fps) : "none");
+}
+
+const CullStats& VK::getCullStats() const {
+    return m_frustumCuller.getStats();
+}
+
 void VK::m_mainLoop() {
     bool shouldClose = true;
     while (shouldClose) {
@@ -46,6 +120,42 @@ void VK::m_mainLoop() {
                 shouldClose = false;
                 break;
             }
+
+            if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F2) {
+                MemoryTracker::get().dumpReport("memory_report.json");
+            }
+
+            if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F3) {
+                // From the requested mode: an unsupported one falls back to FIFO, which would cycle back to it
+                const auto it = std::ranges::find(cycledPresentModes, m_requestedPresentMode);
+                const size_t next = it == cycledPresentModes.end() ? 0 : (it - cycledPresentModes.begin() + 1);
+                setPresentMode(cycledPresentModes[next % cycledPresentModes.size()]);
+            }
+
+            if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F4) {
+                setFrameRateLimit(m_frameLimiter.getTargetFps() > 0.0 ? 0.0 : defaultFrameRateLimit);
+            }
+
+            if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                // Not every driver reports resizes through VK_ERROR_OUT_OF_DATE_KHR
+                m_swapChainDirty = true;
+            }
+
+            if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F11) {
+                const bool isFullscreen = SDL_GetWindowFlags(m_window) & SDL_WINDOW_FULLSCREEN_DESKTOP;
+                SDL_SetWindowFullscreen(m_window, isFullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP);
+                m_swapChainDirty = true;
+            }
+
+            if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F5 && IndirectRenderer::isSupported()) {
+                m_gpuDriven = !m_gpuDriven;
+                fmt::println("GPU driven rendering: {}", m_gpuDriven ? "on" : "off");
+            }
+
+            if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F6) {
+                m_occlusionCulling = !m_occlusionCulling;
+                fmt::println("Occlusion culling: {}", m_occlusionCulling ? "on" : "off");
+            }
         }
 
         Keyboard::update();
@@ -53,51 +163,114 @@ void VK::m_mainLoop() {
 
         m_camera->update(0);
         // m_models[0].rotate(0.02, { 0, 1, 0 });
+        m_updateSceneGraph();
+
+        // Between frames: nothing is being recorded, replaced pipelines are retired past the in-flight frames
+        PipelineManager::get().update();
+        PipelineReloader::get().apply();
 
         m_drawFrame();
-        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        m_frameStats.cpuWait.add(m_frameLimiter.wait());
+        m_reportFrameStats();
     }
 
     vkDeviceWaitIdle(VulkanContext::get().getDevice());
 }
 
 void VK::m_drawFrame() {
-    const VulkanContext& vkContext = VulkanContext::get();
-    vkWaitForFences(vkContext.getDevice(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+    VulkanContext& vkContext = VulkanContext::get();
+    FrameResources& frame = m_frames[m_currentFrame];
+
+    if (m_swapChainDirty) {
+        m_recreateSwapChain();
+
+        // Minimized, nothing to render to
+        if (m_swapChainDirty) {
+            return;
+        }
+    }
+
+    // Only blocks if the GPU is more than m_framesInFlight frames behind
+    const FrameLimiter::Clock::time_point gpuWaitStart = FrameLimiter::Clock::now();
+    vkWaitForFences(vkContext.getDevice(), 1, &frame.inFlight, VK_TRUE, UINT64_MAX);
+    DeletionQueue::get().collect(frame.submissions);
 
     uint32_t imageIndex;
-    VkResult res = vkAcquireNextImageKHR(vkContext.getDevice(), m_swapChain, UINT64_MAX,
-                                         m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult res = vkAcquireNextImageKHR(vkContext.getDevice(), m_swapChain, UINT64_MAX, frame.imageAvailable,
+                                         VK_NULL_HANDLE, &imageIndex);
 
-    if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR) {
+    if (res == VK_ERROR_OUT_OF_DATE_KHR) {
         m_recreateSwapChain();
         return;
     }
 
-    VK_CHECK("failed to acquire next image!", res);
+    // A suboptimal image was still acquired and imageAvailable will be signaled: it has to be rendered
+    // and presented, the swap chain is recreated on the next frame
+    if (res == VK_SUBOPTIMAL_KHR) {
+        m_swapChainDirty = true;
+    } else {
+        VK_CHECK("failed to acquire next image!", res);
+    }
+
+    // The acquired image may still be used by another frame when there are more frames than images
+    if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE && m_imagesInFlight[imageIndex] != frame.inFlight) {
+        vkWaitForFences(vkContext.getDevice(), 1, &m_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    }
+    m_imagesInFlight[imageIndex] = frame.inFlight;
+    m_frameStats.gpuWait.add(FrameLimiter::Clock::now() - gpuWaitStart);
+
+    vkResetFences(vkContext.getDevice(), 1, &frame.inFlight);
 
-    vkResetFences(vkContext.getDevice(), 1, &m_inFlightFences[m_currentFrame]);
+    // The GPU is done with this frame's region of the ring, it can be rewritten
+    m_uniformRing->beginFrame(m_currentFrame);
+    frame.cameraUniformOffset = m_camera->pushUniforms(*m_uniformRing);
+    m_uniformRing->flush();
 
-    vkResetCommandBuffer(m_commandBuffers[m_currentFrame], 0);
-    m_recordCommandBuffer(m_commandBuffers[m_currentFrame], imageIndex);
+    if (m_gpuDriven) {
+        m_indirectRenderer->update(m_currentFrame, m_entities);
+    } else {
+        m_cullEntities();
+    }
+    m_buildRenderQueue();
+
+    vkResetCommandBuffer(frame.commandBuffer, 0);
+    m_recordCommandBuffer(frame, imageIndex);
+
+    // What the next frame's occlusion culling reprojects against
+    m_previousViewProjection = m_camera->getProjection() * m_camera->getView();
+    m_depthHistoryValid = true;
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    const VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
-    const VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    // Along with the uploads submitted since the last frame, which its acquire barriers chain after
+    std::vector waitSemaphores = { frame.imageAvailable };
+    std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    const std::vector<VkSemaphore> uploadSemaphores = vkContext.takeUploadSemaphores();
+    for (const VkSemaphore& semaphore : uploadSemaphores) {
+        waitSemaphores.push_back(semaphore);
+        waitStages.push_back(VulkanContext::uploadWaitStage);
+    }
+
+    submitInfo.waitSemaphoreCount = waitSemaphores.size();
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrame];
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
 
-    const VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[m_currentFrame] };
+    const VkSemaphore signalSemaphores[] = { frame.renderFinished };
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     VK_CHECK("failed to submit draw command buffer!",
-             vkQueueSubmit(vkContext.getGraphicsQueue(), 1, &submitInfo, m_inFlightFences[m_currentFrame]));
+             vkQueueSubmit(vkContext.getGraphicsQueue(), 1, &submitInfo, frame.inFlight));
+
+    // Destroyed once this frame completes, like everything retired before its submission
+    for (const VkSemaphore& semaphore : uploadSemaphores) {
+        DeletionQueue::get().retire(
+            [semaphore] { vkDestroySemaphore(VulkanContext::get().getDevice(), semaphore, nullptr); });
+    }
+    frame.submissions = DeletionQueue::get().onSubmit();
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -110,13 +283,117 @@ void VK::m_drawFrame() {
     presentInfo.pImageIndices = &imageIndex;
 
     res = vkQueuePresentKHR(vkContext.getPresentQueue(), &presentInfo);
+
+    const FrameLimiter::Clock::time_point now = FrameLimiter::Clock::now();
+    if (m_lastPresent != FrameLimiter::Clock::time_point{}) {
+        m_frameStats.presentInterval.add(now - m_lastPresent);
+    }
+    m_lastPresent = now;
     if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR) {
         m_recreateSwapChain();
     } else {
         VK_CHECK("failed to present queue!", res);
     }
 
-    m_currentFrame = m_currentFrame % maxInflightFrames;
+    m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+}
+
+void VK::m_reportFrameStats() {
+    const FrameLimiter::Clock::time_point now = FrameLimiter::Clock::now();
+    if (now - m_lastStatsReport < frameStatsReportInterval) {
+        return;
+    }
+
+    m_lastStatsReport = now;
+    if (m_frameStats.presentInterval.count == 0) {
+        return;
+    }
+
+    const TimingStat& present = m_frameStats.presentInterval;
+    fmt::println("[{}] {:.1f} fps | present {:.2f}ms (min {:.2f} / max {:.2f}) | cpu wait {:.2f}ms | gpu wait {:.2f}ms",
+                 string_VkPresentModeKHR(m_presentMode), 1000.0 / present.getAverage(), present.getAverage(),
+                 present.getMin(), present.max, m_frameStats.cpuWait.getAverage(),
+                 m_frameStats.gpuWait.getAverage());
+
+    if (!m_gpuDriven) {
+        const CullStats& cullStats = m_frustumCuller.getStats();
+        fmt::println("culling: {}/{} visible ({} culled) in {:.3f}ms", cullStats.visible, cullStats.tested,
+                     cullStats.getCulled(), m_frameStats.cull.getAverage());
+    }
+
+    m_frameStats.reset();
+}
+
+void VK::m_updateSceneGraph() {
+    m_sceneGraph.update(*m_recordingThreads);
+
+    // Only entities that moved, or whose node moved, are recomputed
+    m_entities.updateTransforms(m_sceneGraph);
+}
+
+void VK::m_spawnModel(const Model& model, const GLTFLoader& loader) {
+    const std::vector<SceneGraph::NodeID> graphNodes = loader.addToSceneGraph(m_sceneGraph);
+
+    // The model's meshes are the loader's, in the same order
+    for (size_t i = 0; i < loader.nodes.size(); ++i) {
+        if (loader.nodes[i].mesh < 0) {
+            continue;
+        }
+
+        const GLTF::MeshPrimitives& primitives = loader.meshPrimitives[loader.nodes[i].mesh];
+        for (uint32_t mesh = primitives.first; mesh < primitives.first + primitives.count; ++mesh) {
+            const MaterialRef material{ .textureID = model.getTextureID(),
+                                        .features = model.getMaterialFeatures(mesh) };
+            m_entities.create(*model.getMeshes()[mesh], material, model.getTransform(), graphNodes[i]);
+        }
+    }
+}
+
+void VK::m_cullEntities() {
+    const FrameLimiter::Clock::time_point start = FrameLimiter::Clock::now();
+
+    // Culler indices are dense entity indices
+    m_frustumCuller.clear();
+    m_frustumCuller.reserve(m_entities.size());
+    for (const AABB& worldBox : m_entities.getWorldBounds()) {
+        m_frustumCuller.add(worldBox);
+    }
+
+    const Frustum frustum = Frustum::fromViewProjection(m_camera->getProjection() * m_camera->getView());
+    m_entities.setVisible(m_frustumCuller.cull(frustum));
+    m_instanceBatcher->update(m_currentFrame, m_entities, m_camera->getTransform().position);
+
+    m_frameStats.cull.add(FrameLimiter::Clock::now() - start);
+}
+
+void VK::m_buildRenderQueue() {
+    // The previous frame's queue has been fully recorded by now
+    m_frameAllocator.reset();
+
+    const uint32_t batchCount = m_gpuDriven ? m_indirectRenderer->getBatchCount(m_currentFrame)
+                                            : m_instanceBatcher->getBatchCount(m_currentFrame);
+    m_renderQueue->reset(m_frameAllocator, m_skybox->getMeshes().size() + batchCount);
+
+    const PipelineManager& pipelines = PipelineManager::get();
+
+    // Pipelines still being built skip their draws rather than stalling the frame
+    if (const Pipeline* skyboxPipeline = pipelines.find(skyboxPipelineKey)) {
+        m_skybox->submit(*m_renderQueue, m_frameAllocator, *skyboxPipeline,
+                         m_textures[m_skybox->getTextureID()].getDescriptorSet(), RenderQueue::Pass::Background,
+                         m_camera->getTransform().position);
+    }
+
+    const ScenePipelineResolver resolveScenePipeline = [this](const MaterialFeatures features) {
+        return m_getScenePipeline(features);
+    };
+
+    if (m_gpuDriven) {
+        m_indirectRenderer->submit(*m_renderQueue, m_currentFrame, resolveScenePipeline, m_textures);
+    } else {
+        m_instanceBatcher->submit(*m_renderQueue, m_currentFrame, resolveScenePipeline, m_textures);
+    }
+
+    m_renderQueue->sort();
 }
 
 bool VK::m_setupVVL(const std::vector<const char*>& requestedLayers) const {
@@ -215,12 +492,11 @@ VkSurfaceFormatKHR VK::m_chooseSurfaceFormat(const std::vector<VkSurfaceFormatKH
 }
 
 VkPresentModeKHR VK::m_chooseSurfacePresentMode(const std::vector<VkPresentModeKHR>& availableModes) {
-    for (const auto& availableMode : availableModes) {
-        if (availableMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-            return availableMode;
-        }
+    if (std::ranges::find(availableModes, m_requestedPresentMode) != availableModes.end()) {
+        return m_requestedPresentMode;
     }
 
+    fmt::println("{} is not supported, falling back to FIFO", string_VkPresentModeKHR(m_requestedPresentMode));
     return VK_PRESENT_MODE_FIFO_KHR; // VSync
 }
 
@@ -239,28 +515,34 @@ VkExtent2D VK::m_chooseSurfaceExtent(const VkSurfaceCapabilitiesKHR& capabilitie
     return extent;
 }
 
-void VK::m_createSwapChain() {
+void VK::m_createSwapChain(const VkSwapchainKHR oldSwapChain) {
     const VulkanContext& vkContext = VulkanContext::get();
     const SwapChainSupportDetails& swapChainDetails = vkContext.getPhysicalDevice().getSwapChainSupportDetails();
     const VkSurfaceFormatKHR surfaceFormat = m_chooseSurfaceFormat(swapChainDetails.formats);
     const VkPresentModeKHR presentMode = m_chooseSurfacePresentMode(swapChainDetails.presentModes);
-    const VkExtent2D extent = m_chooseSurfaceExtent(swapChainDetails.capabilities);
+
+    // Capabilities (extent range, transform) change with the window, the ones cached at device selection are stale
+    VkSurfaceCapabilitiesKHR capabilities{};
+    VK_CHECK("Failed to get surface capabilities",
+             vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vkContext.getPhysicalDevice().getUnderlying(), m_surface,
+                                                       &capabilities));
+    const VkExtent2D extent = m_chooseSurfaceExtent(capabilities);
 
     // Basic SwapChain settings
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     createInfo.surface = m_surface;
-    createInfo.minImageCount = swapChainDetails.capabilities.minImageCount + 1;
+    createInfo.minImageCount = capabilities.minImageCount + 1;
     createInfo.imageFormat = surfaceFormat.format;
     createInfo.imageColorSpace = surfaceFormat.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     createInfo.presentMode = presentMode;
-    createInfo.preTransform = swapChainDetails.capabilities.currentTransform;
+    createInfo.preTransform = capabilities.currentTransform;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapChain;
 
     // QueueFamilies handling
     const QueueFamilyIndices& indices = vkContext.getPhysicalDevice().getQueueFamilyIndices();
@@ -289,36 +571,59 @@ void VK::m_createSwapChain() {
 
     m_swapChainImageFormat = surfaceFormat.format;
     m_swapChainExtent = extent;
+    m_presentMode = presentMode;
 }
 
-void VK::m_destroySwapChain() const {
-    const VkDevice& device = VulkanContext::get().getDevice();
+void VK::m_retireSwapChain() {
+    DeletionQueue::get().retire([framebuffers = std::move(m_framebuffers),
+                                 imageViews = std::move(m_swapChainImageViews), swapChain = m_swapChain] {
+        const VkDevice& device = VulkanContext::get().getDevice();
 
-    for (const VkFramebuffer& framebuffer : m_framebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
+        for (const VkFramebuffer& framebuffer : framebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
 
-    for (const VkImageView& imageView : m_swapChainImageViews) {
-        vkDestroyImageView(device, imageView, nullptr);
-    }
+        for (const VkImageView& imageView : imageViews) {
+            vkDestroyImageView(device, imageView, nullptr);
+        }
+
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
+    });
 
-    vkDestroySwapchainKHR(device, m_swapChain, nullptr);
+    m_framebuffers.clear();
+    m_swapChainImageViews.clear();
+    m_swapChainImages.clear();
+    m_swapChain = VK_NULL_HANDLE;
 }
 
 void VK::m_recreateSwapChain() {
-    fmt::println("Recreating swap chain");
+    // A minimized window has a zero sized drawable, retry once it's restored
+    int width = 0;
+    int height = 0;
+    SDL_Vulkan_GetDrawableSize(m_window, &width, &height);
+    if (width == 0 || height == 0) {
+        m_swapChainDirty = true;
+        return;
+    }
 
-    vkDeviceWaitIdle(VulkanContext::get().getDevice());
+    fmt::println("Recreating swap chain");
+    m_swapChainDirty = false;
 
-    m_destroySwapChain();
+    // No device wait: the old swap chain and everything built on it are destroyed
+    // by the DeletionQueue once the frames still using them are done.
+    const VkSwapchainKHR oldSwapChain = m_swapChain;
+    m_retireSwapChain();
 
-    m_createSwapChain();
+    m_createSwapChain(oldSwapChain);
     m_createImageViews();
+    m_createDepthResources();  // Assigning the handle retires the previous depth image
+    m_createFramebuffers();
 
-    m_depthImage->destroy();
-    m_createDepthResources();
+    // Pipelines use dynamic viewport and scissor, they don't depend on the extent
+    m_camera->setAspectRatio(static_cast<float>(m_swapChainExtent.width) /
+                             static_cast<float>(m_swapChainExtent.height));
 
-    m_createFramebuffers();
+    m_imagesInFlight.assign(m_swapChainImages.size(), VK_NULL_HANDLE);
 }
 
 void VK::m_createImageViews() {
@@ -350,14 +655,15 @@ void VK::m_createImageViews() {
 void VK::m_createRenderPass() {
     // Color attachment
     VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = m_swapChainImageFormat;
+    colorAttachment.format = m_pipelineTarget.colorFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Layouts are transitioned by the render graph around the pass
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -365,13 +671,13 @@ void VK::m_createRenderPass() {
 
     // Depth attachment
     VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = VK_FORMAT_D32_SFLOAT; // TODO: findDepthFormat();
+    depthAttachment.format = m_pipelineTarget.depthFormat;
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;  // Reduced into the hi-z pyramid next frame
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference depthAttachmentRef{};
@@ -384,13 +690,7 @@ void VK::m_createRenderPass() {
     subpass.pColorAttachments = &colorAttachmentRef;
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask =
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    // No subpass dependencies: the render graph synchronizes the attachments with pipeline barriers
 
     const std::array attachments = { colorAttachment, depthAttachment };
 
@@ -400,8 +700,6 @@ void VK::m_createRenderPass() {
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
 
     VK_CHECK("Failed to create render pass!",
              vkCreateRenderPass(VulkanContext::get().getDevice(), &renderPassInfo, nullptr, &m_renderPass));
@@ -411,7 +709,7 @@ void VK::m_createDescriptorSetLayout() {
     VkDescriptorSetLayoutBinding sceneLayoutBinding{};
     sceneLayoutBinding.binding = 0;
     sceneLayoutBinding.descriptorCount = 1;
-    sceneLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    sceneLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     sceneLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
@@ -438,6 +736,56 @@ void VK::m_createDescriptorSetLayout() {
 void VK::m_createGraphicsPipeline() {
     const VulkanContext& vkContext = VulkanContext::get();
 
+    VkPushConstantRange pushConstant{};
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstant.offset = 0;
+    pushConstant.size = sizeof(ModelConstants);
+
+    const std::array layouts{ m_sceneDescriptorSetLayout, m_textureDescriptorSetLayout,
+                              m_indirectRenderer->getObjectSetLayout() };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = layouts.size();
+    pipelineLayoutInfo.pSetLayouts = layouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+
+    VK_CHECK("Failed to create pipeline layout!",
+             vkCreatePipelineLayout(vkContext.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+    // Built on the PipelineManager threads, draws are skipped until they are ready
+    PipelineManager::get().request(skyboxPipelineKey, { "./shaders/skybox.vert", "./shaders/skybox.frag" }, [this] {
+        return m_buildGraphicsPipeline("./shaders/skybox.vert", "./shaders/skybox.frag", false);
+    });
+
+    m_requestScenePipeline(genericMaterialFeatures);
+}
+
+void VK::m_requestScenePipeline(const MaterialFeatures features) {
+    const auto build = [this, features] {
+        const SceneSpecialization specialization = SceneSpecialization::fromFeatures(features);
+        const VkSpecializationInfo specializationInfo = specialization.getInfo();
+
+        return m_buildGraphicsPipeline("./shaders/instanced.vert", "./shaders/tri.frag", true, &specializationInfo);
+    };
+
+    PipelineManager::get().request(getScenePipelineKey(features),
+                                   { "./shaders/instanced.vert", "./shaders/tri.frag" }, build);
+}
+
+const Pipeline* VK::m_getScenePipeline(const MaterialFeatures features) {
+    const PipelineManager::Key key = getScenePipelineKey(features);
+    if (PipelineManager::get().getState(key) == PipelineManager::State::Unknown) {
+        m_requestScenePipeline(features);
+    }
+
+    return PipelineManager::get().findOrFallback(key, getScenePipelineKey(genericMaterialFeatures));
+}
+
+std::unique_ptr<Pipeline> VK::m_buildGraphicsPipeline(const char* vertexShaderPath, const char* fragmentShaderPath,
+                                                      const bool isOpaque,
+                                                      const VkSpecializationInfo* fragmentSpecialization) const {
     VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
     std::array attributeDescriptions = Vertex::getAttributeDescriptions();
 
@@ -452,22 +800,11 @@ void VK::m_createGraphicsPipeline() {
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
-    VkViewport viewport{};
-    viewport.width = static_cast<float>(m_swapChainExtent.width);
-    viewport.height = static_cast<float>(m_swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = m_swapChainExtent;
-
+    // Viewport and scissor are dynamic, see m_recordCommandBuffer
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -503,40 +840,21 @@ void VK::m_createGraphicsPipeline() {
 
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
+    // The skybox is drawn behind everything, without depth
+    depthStencil.depthTestEnable = isOpaque;
+    depthStencil.depthWriteEnable = isOpaque;
     depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
 
-    VkPushConstantRange pushConstant{};
-    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    pushConstant.offset = 0;
-    pushConstant.size = sizeof(ModelConstants);
-
-    const VkDescriptorSetLayout layouts[]{ m_sceneDescriptorSetLayout, m_textureDescriptorSetLayout };
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 2;
-    pipelineLayoutInfo.pSetLayouts = layouts;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
-
-    VK_CHECK("Failed to create pipeline layout!",
-             vkCreatePipelineLayout(vkContext.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
-
-    m_pipelines.scene = std::make_unique<Pipeline>(
-        Pipeline::Type::Graphics, "./shaders/tri.vert", "./shaders/tri.frag", vtxInputInfo, inputAssembly,
-        viewportState, rasterizer, multisampling, colorBlending, depthStencil, m_pipelineLayout, m_renderPass);
-
-    depthStencil.depthWriteEnable = VK_FALSE;
-    depthStencil.depthTestEnable = VK_FALSE;
-
-    m_pipelines.skybox = std::make_unique<Pipeline>(
-        Pipeline::Type::Graphics, "./shaders/skybox.vert", "./shaders/skybox.frag", vtxInputInfo, inputAssembly,
-        viewportState, rasterizer, multisampling, colorBlending, depthStencil, m_pipelineLayout, m_renderPass);
+    return std::make_unique<Pipeline>(Pipeline::Type::Graphics, vertexShaderPath, fragmentShaderPath, vtxInputInfo,
+                                      inputAssembly, viewportState, rasterizer, multisampling, colorBlending,
+                                      depthStencil, m_pipelineLayout, m_pipelineTarget, fragmentSpecialization);
 }
 
 void VK::m_createFramebuffers() {
+    if (m_dynamicRendering) {
+        return;
+    }
+
     m_framebuffers.resize(m_swapChainImageViews.size());
     for (int i = 0; i < m_swapChainImageViews.size(); ++i) {
         const std::array attachments = { m_swapChainImageViews[i], m_depthImage->getImageView() };
@@ -557,22 +875,22 @@ void VK::m_createFramebuffers() {
 
 void VK::m_createCommandBuffers() {
     const VulkanContext& vkContext = VulkanContext::get();
-    m_commandBuffers.resize(maxInflightFrames);
+    m_frames.resize(m_framesInFlight);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = vkContext.getCommandPool();
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = m_commandBuffers.size();
+    allocInfo.commandBufferCount = 1;
 
-    VK_CHECK("failed to create command buffers!",
-             vkAllocateCommandBuffers(vkContext.getDevice(), &allocInfo, m_commandBuffers.data()));
+    for (FrameResources& frame : m_frames) {
+        VK_CHECK("failed to create command buffers!",
+                 vkAllocateCommandBuffers(vkContext.getDevice(), &allocInfo, &frame.commandBuffer));
+    }
 }
 
 void VK::m_createSyncObjects() {
-    m_imageAvailableSemaphores.resize(maxInflightFrames);
-    m_renderFinishedSemaphores.resize(maxInflightFrames);
-    m_inFlightFences.resize(maxInflightFrames);
+    m_imagesInFlight.assign(m_swapChainImages.size(), VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -583,15 +901,14 @@ void VK::m_createSyncObjects() {
 
     const VulkanContext& vkContext = VulkanContext::get();
 
-    for (int i = 0; i < maxInflightFrames; ++i) {
+    for (FrameResources& frame : m_frames) {
         VK_CHECK("failed to create semaphore",
-                 vkCreateSemaphore(vkContext.getDevice(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]));
+                 vkCreateSemaphore(vkContext.getDevice(), &semaphoreInfo, nullptr, &frame.imageAvailable));
 
         VK_CHECK("failed to create semaphore",
-                 vkCreateSemaphore(vkContext.getDevice(), &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]));
+                 vkCreateSemaphore(vkContext.getDevice(), &semaphoreInfo, nullptr, &frame.renderFinished));
 
-        VK_CHECK("failed to create fence",
-                 vkCreateFence(vkContext.getDevice(), &fenceInfo, nullptr, &m_inFlightFences[i]));
+        VK_CHECK("failed to create fence", vkCreateFence(vkContext.getDevice(), &fenceInfo, nullptr, &frame.inFlight));
     }
 }
 
@@ -601,13 +918,21 @@ void VK::m_createDepthResources() {
     extent.height = m_swapChainExtent.height;
     extent.depth = 1;
 
-    m_depthImage = std::make_unique<DepthImage>(extent);
-    m_depthImage->transitionLayout(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    // Transitioned by the render graph on first use
+    m_depthImage = makeGpuHandle<DepthImage>(extent, m_pipelineTarget.depthFormat);
+    m_depthState = {};
+
+    // Same for the pyramid, its first build transitions it in the frame's command buffer
+    m_hiZPyramid->resize(*m_depthImage);
+    m_hiZState = {};
+
+    // Nothing has been rendered to the new depth image yet
+    m_depthHistoryValid = false;
 }
 
 void VK::m_createDescriptorPool() {
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     poolSizes[0].descriptorCount = 1;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = 2;
@@ -622,57 +947,196 @@ void VK::m_createDescriptorPool() {
              vkCreateDescriptorPool(VulkanContext::get().getDevice(), &poolInfo, nullptr, &m_descriptorPool));
 }
 
-void VK::m_recordCommandBuffer(VkCommandBuffer commandBuffer, const uint32_t imageIndex) const {
+void VK::m_recordCommandBuffer(const FrameResources& frame, const uint32_t imageIndex) {
+    const VkCommandBuffer commandBuffer = frame.commandBuffer;
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
     VK_CHECK("failed to begin recording command buffer", vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = m_renderPass;
-    renderPassInfo.framebuffer = m_framebuffers[imageIndex];
+    // Take ownership of everything uploaded through the transfer queue since last frame
+    VulkanContext::get().recordPendingAcquires(commandBuffer);
+
+    // Per frame resources start fresh, the frame's fence covers their previous use.
+    // The swap chain image is available once the acquire semaphore, waited on at color output, is signaled.
+    RenderGraph::ResourceState swapChainState{ .writeStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    RenderGraph::ResourceState drawCommandsState;
+    RenderGraph::ResourceState drawCountsState;
+
+    m_renderGraph.reset();
+
+    const RenderGraph::ResourceID swapChainImage =
+        m_renderGraph.importImage("swap chain", m_swapChainImages[imageIndex], m_swapChainImageViews[imageIndex],
+                                  VK_IMAGE_ASPECT_COLOR_BIT, 1, swapChainState);
+    const RenderGraph::ResourceID depth = m_renderGraph.importImage(
+        "depth", m_depthImage->getImage(), m_depthImage->getImageView(), VK_IMAGE_ASPECT_DEPTH_BIT, 1, m_depthState);
+
+    RenderGraph::ResourceID drawCommands = 0;
+    RenderGraph::ResourceID drawCounts = 0;
+    if (m_gpuDriven) {
+        drawCommands = m_renderGraph.importBuffer(
+            "draw commands", m_indirectRenderer->getDrawCommandBuffer(m_currentFrame), drawCommandsState);
+        drawCounts = m_renderGraph.importBuffer("draw counts", m_indirectRenderer->getDrawCountBuffer(m_currentFrame),
+                                                drawCountsState);
+
+        // Occlusion tests against last frame's depth, reduced into the hi-z pyramid first
+        const bool occlusion = m_occlusionCulling && m_depthHistoryValid;
+        RenderGraph::ResourceID hiZ = 0;
+        if (occlusion) {
+            hiZ = m_renderGraph.importImage("hi-z", m_hiZPyramid->getImage(), VK_NULL_HANDLE,
+                                            VK_IMAGE_ASPECT_COLOR_BIT, m_hiZPyramid->getMipLevels(), m_hiZState);
+
+            m_renderGraph
+                .addPass("hi-z build",
+                         [this](const VkCommandBuffer& cmd, const RenderGraph&) { m_hiZPyramid->build(cmd); })
+                .read(depth, RenderGraph::Usage::ComputeSampled)
+                .write(hiZ, RenderGraph::Usage::ComputeGeneral);
+        }
+
+        m_renderGraph
+            .addPass("cull clear",
+                     [this](const VkCommandBuffer& cmd, const RenderGraph&) {
+                         m_indirectRenderer->clear(cmd, m_currentFrame);
+                     })
+            .write(drawCommands, RenderGraph::Usage::Transfer)
+            .write(drawCounts, RenderGraph::Usage::Transfer);
+
+        RenderGraph::PassBuilder cull =
+            m_renderGraph
+                .addPass("cull",
+                         [this, occlusion](const VkCommandBuffer& cmd, const RenderGraph&) {
+                             const Frustum frustum =
+                                 Frustum::fromViewProjection(m_camera->getProjection() * m_camera->getView());
+                             m_indirectRenderer->cull(cmd, m_currentFrame, frustum, m_previousViewProjection,
+                                                      *m_hiZPyramid, occlusion);
+                         })
+                .write(drawCommands, RenderGraph::Usage::ComputeGeneral)
+                .write(drawCounts, RenderGraph::Usage::ComputeGeneral);
+        if (occlusion) {
+            cull.read(hiZ, RenderGraph::Usage::ComputeGeneral);
+        }
+    }
+
+    RenderGraph::PassBuilder scene =
+        m_renderGraph
+            .addPass("scene",
+                     [this, &frame, imageIndex](const VkCommandBuffer& cmd, const RenderGraph&) {
+                         m_recordScenePass(cmd, frame, imageIndex);
+                     })
+            .write(swapChainImage, RenderGraph::Usage::ColorAttachment)
+            .write(depth, RenderGraph::Usage::DepthAttachment);
+    if (m_gpuDriven) {
+        scene.read(drawCommands, RenderGraph::Usage::IndirectBuffer)
+            .read(drawCounts, RenderGraph::Usage::IndirectBuffer);
+    }
 
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = m_swapChainExtent;
+    m_renderGraph.markOutput(swapChainImage, RenderGraph::Usage::Present);
+    m_renderGraph.compile();
+    m_renderGraph.execute(commandBuffer);
+
+    VK_CHECK("failed to record command buffer!", vkEndCommandBuffer(commandBuffer));
+}
 
+void VK::m_recordScenePass(const VkCommandBuffer& commandBuffer, const FrameResources& frame,
+                           const uint32_t imageIndex) const {
     // clang-format off
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color = {{ 0, 0, 0, 1.0f }};
     clearValues[1].depthStencil = { 1.0f, 0 };
     // clang-format on
 
-    renderPassInfo.clearValueCount = clearValues.size();
-    renderPassInfo.pClearValues = clearValues.data();
-
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    VkCommandBufferInheritanceRenderingInfoKHR inheritanceRendering{};
+    inheritanceRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    // CONTENTS_SECONDARY only belongs to the primary's VkRenderingInfo, here it needs nestedCommandBuffer
+    inheritanceRendering.flags = 0;
+    inheritanceRendering.colorAttachmentCount = 1;
+    inheritanceRendering.pColorAttachmentFormats = &m_pipelineTarget.colorFormat;
+    inheritanceRendering.depthAttachmentFormat = m_pipelineTarget.depthFormat;
+    inheritanceRendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    if (m_dynamicRendering) {
+        // Same load and store operations as the render pass, the render graph transitions the layouts
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageView = m_swapChainImageViews[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearValues[0];
+
+        VkRenderingAttachmentInfoKHR depthAttachment{};
+        depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        depthAttachment.imageView = m_depthImage->getImageView();
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;  // Reduced into the hi-z pyramid next frame
+        depthAttachment.clearValue = clearValues[1];
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+        renderingInfo.renderArea.offset = { 0, 0 };
+        renderingInfo.renderArea.extent = m_swapChainExtent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        renderingInfo.pDepthAttachment = &depthAttachment;
+
+        VulkanContext::get().getExtensionFunctions().cmdBeginRendering(commandBuffer, &renderingInfo);
+
+        inheritance.pNext = &inheritanceRendering;
+    } else {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_renderPass;
+        renderPassInfo.framebuffer = m_framebuffers[imageIndex];
 
-    m_pipelines.skybox->bind(commandBuffer);
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = m_swapChainExtent;
 
-    const Texture& skyTex = m_textures[m_skybox->getTextureID()];
-    const std::array descriptorSets{
-        m_camera->getDescriptorSet(),
-        skyTex.getDescriptorSet()
-    };
+        renderPassInfo.clearValueCount = clearValues.size();
+        renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, descriptorSets.size(),
-                            descriptorSets.data(), 0, nullptr);
-    m_skybox->draw(commandBuffer, m_pipelineLayout);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-    m_pipelines.scene->bind(commandBuffer);
-    m_drawModels(commandBuffer);
-    vkCmdEndRenderPass(commandBuffer);
+        inheritance.renderPass = m_renderPass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = m_framebuffers[imageIndex];
+    }
 
-    VK_CHECK("failed to record command buffer!", vkEndCommandBuffer(commandBuffer));
-}
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(m_swapChainExtent.width);
+    viewport.height = static_cast<float>(m_swapChainExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
 
-void VK::m_drawModels(VkCommandBuffer commandBuffer) const {
-    for (const auto& model : m_models) {
-        const Texture& texture = m_textures[model.getTextureID()];
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1, 1,
-                                &texture.getDescriptorSet(), 0, nullptr);
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = m_swapChainExtent;
 
-        model.draw(commandBuffer, m_pipelineLayout);
+    // The sorted render queue is sliced across the recording threads.
+    // Secondaries start with no state at all (dynamic state included), every slice sets what it needs
+    const std::vector<VkCommandBuffer> secondaries = m_parallelRecorder->record(
+        m_currentFrame, inheritance, m_renderQueue->size(),
+        [&](const VkCommandBuffer secondary, const uint32_t begin, const uint32_t end) {
+            vkCmdSetViewport(secondary, 0, 1, &viewport);
+            vkCmdSetScissor(secondary, 0, 1, &scissor);
+            m_renderQueue->record(secondary, begin, end, m_pipelineLayout, m_camera->getDescriptorSet(),
+                                  frame.cameraUniformOffset);
+        });
+
+    // Nothing to draw (empty or fully culled scene): the pass still runs for its clears and is ended as usual
+    if (!secondaries.empty()) {
+        vkCmdExecuteCommands(commandBuffer, secondaries.size(), secondaries.data());
+    }
+    if (m_dynamicRendering) {
+        VulkanContext::get().getExtensionFunctions().cmdEndRendering(commandBuffer);
+    } else {
+        vkCmdEndRenderPass(commandBuffer);
     }
 }
 
@@ -683,13 +1147,40 @@ void VK::m_initVulkan() {
     m_createSurface();
 
     VulkanContext::get().init(m_instance, m_surface);
+    PipelineCache::get().init(pipelineCachePath);
+    ShaderCache::get().init(shaderCacheDirectory);
+    ShaderCache::get().prewarm("./shaders");
+    PipelineReloader::get().start("./shaders");
+    PipelineManager::get().init(pipelineBuildThreads);
+    GeometryArena::get().init(geometryArenaVertexCapacity, geometryArenaIndexCapacity);
+
+    m_createDescriptorSetLayout();
+    m_createDescriptorPool();
+
+    // Owns the object set layout (set 2) of the graphics pipeline layout
+    m_indirectRenderer = std::make_unique<IndirectRenderer>(m_framesInFlight, maxIndirectObjects, maxIndirectMaterials);
+    m_gpuDriven = IndirectRenderer::isSupported();
+    fmt::println("GPU driven rendering: {}", m_gpuDriven ? "on" : "unsupported");
+
+    // Pipelines only depend on the attachment formats, which are known before the swap chain exists:
+    // they compile on the PipelineManager threads while the swap chain and the assets are set up
+    m_dynamicRendering = VulkanContext::get().hasDynamicRendering();
+    fmt::println("Dynamic rendering: {}", m_dynamicRendering ? "on" : "unsupported");
+
+    const SwapChainSupportDetails& swapChainDetails =
+        VulkanContext::get().getPhysicalDevice().getSwapChainSupportDetails();
+    m_pipelineTarget.colorFormat = m_chooseSurfaceFormat(swapChainDetails.formats).format;
+    m_pipelineTarget.depthFormat = VK_FORMAT_D32_SFLOAT;  // TODO: findDepthFormat();
+    if (!m_dynamicRendering) {
+        m_createRenderPass();
+        m_pipelineTarget.renderPass = m_renderPass;
+    }
+    m_createGraphicsPipeline();
 
     m_createSwapChain();
     m_createImageViews();
-    m_createRenderPass();
+    m_hiZPyramid = std::make_unique<HiZPyramid>();
     m_createDepthResources();
-    m_createDescriptorSetLayout();
-    m_createDescriptorPool();
 
     m_textures.emplace_back(std::vector{ "./assets/models/avocado/avocado_baseColor.png" }, m_descriptorPool,
                             m_textureDescriptorSetLayout);
@@ -703,38 +1194,66 @@ void VK::m_initVulkan() {
                                 "./assets/skybox/hl1/front.bmp",
                             }, m_descriptorPool, m_textureDescriptorSetLayout);
 
-    m_models.emplace_back(GLTFLoader("./assets/models/avocado/Avocado.gltf"));
-    m_models[0].rotate(3.14116, { 0, 1, 0 });
+    // The avocado faces the camera through its node's rotation
+    const GLTFLoader avocado("./assets/models/avocado/Avocado.gltf");
+    m_models.emplace_back(avocado);
+    m_spawnModel(m_models.back(), avocado);
     // m_models.emplace_back("./assets/models/triangles/SimpleMeshes.gltf");
     m_skybox = std::make_unique<Cube>(m_textures[1].getID());
 
+    // Permutations of the loaded models are built upfront, new ones on first sight
+    for (const Model& model : m_models) {
+        for (size_t mesh = 0; mesh < model.getMeshes().size(); ++mesh) {
+            m_requestScenePipeline(model.getMaterialFeatures(mesh));
+        }
+    }
+
+    m_instanceBatcher =
+        std::make_unique<InstanceBatcher>(m_framesInFlight, maxInstances, m_indirectRenderer->getObjectSetLayout());
+    m_renderQueue = std::make_unique<RenderQueue>();
+
     // m_createDescriptorSets();
-    m_createGraphicsPipeline();
     m_createFramebuffers();
 
     m_createCommandBuffers();
     m_createSyncObjects();
 
+    m_recordingThreads = std::make_unique<ThreadPool>(
+        std::min(maxRecordingThreads, std::max(1u, std::thread::hardware_concurrency())));
+    m_parallelRecorder = std::make_unique<ParallelRecorder>(*m_recordingThreads, m_framesInFlight);
+
     const float aspectRatio =
         static_cast<float>(m_swapChainExtent.width) / static_cast<float>(m_swapChainExtent.height);
-    m_camera = std::make_unique<Camera>(aspectRatio, m_descriptorPool, m_sceneDescriptorSetLayout);
+    m_uniformRing = std::make_unique<UniformRing>(uniformRingFrameSize, m_framesInFlight);
+    m_camera = std::make_unique<Camera>(aspectRatio, m_descriptorPool, m_sceneDescriptorSetLayout, *m_uniformRing);
     m_camera->setPosition({ 0.0f, 0.0f, 0.2f });
 
+    // Only the generic scene pipeline is waited for, as other permutations fall back to it
+    PipelineManager::get().wait(getScenePipelineKey(genericMaterialFeatures));
+
     fmt::println("Good to go :)");
 }
 
-void VK::m_destroyVulkan() const {
-    m_destroySwapChain();
+void VK::m_destroyVulkan() {
+    // Before anything a pipeline factory may use goes away
+    PipelineReloader::get().stop();
+
+    m_retireSwapChain();
 
     VulkanContext& vkContext = VulkanContext::get();
 
-    m_camera->destroy();
+    m_uniformRing->destroy();
+    m_parallelRecorder->destroy();
+    m_indirectRenderer->destroy();
+    m_instanceBatcher->destroy();
+    m_hiZPyramid->destroy();
+    m_renderGraph.destroy();
     vkDestroyDescriptorPool(vkContext.getDevice(), m_descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(vkContext.getDevice(), m_sceneDescriptorSetLayout, nullptr);
     vkDestroyDescriptorSetLayout(vkContext.getDevice(), m_textureDescriptorSetLayout, nullptr);
 
-    m_depthImage->destroy();
-    for (const auto& texture : m_textures) {
+    m_depthImage.reset();
+    for (auto& texture : m_textures) {
         texture.destroy();
     }
 
@@ -743,18 +1262,23 @@ void VK::m_destroyVulkan() const {
         model.destroy();
     }
 
-    m_pipelines.scene->destroy();
-    m_pipelines.skybox->destroy();
+    PipelineManager::get().destroy();
+    GeometryArena::get().destroy();
+
+    // The device is idle at this point, everything retired can go
+    DeletionQueue::get().flush();
+    PipelineCache::get().destroy();
 
     vkDestroyPipelineLayout(vkContext.getDevice(), m_pipelineLayout, nullptr);
     vkDestroyRenderPass(vkContext.getDevice(), m_renderPass, nullptr);
 
-    for (int i = 0; i < maxInflightFrames; ++i) {
-        vkDestroySemaphore(vkContext.getDevice(), m_imageAvailableSemaphores[i], nullptr);
-        vkDestroySemaphore(vkContext.getDevice(), m_renderFinishedSemaphores[i], nullptr);
-        vkDestroyFence(vkContext.getDevice(), m_inFlightFences[i], nullptr);
+    for (const FrameResources& frame : m_frames) {
+        vkDestroySemaphore(vkContext.getDevice(), frame.imageAvailable, nullptr);
+        vkDestroySemaphore(vkContext.getDevice(), frame.renderFinished, nullptr);
+        vkDestroyFence(vkContext.getDevice(), frame.inFlight, nullptr);
     }
 
+    MemoryTracker::get().reportLeaks();
     vkContext.destroy();
     vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
     vkDestroyInstance(m_instance, nullptr);
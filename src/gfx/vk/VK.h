@@ -6,17 +6,45 @@
 #include <memory>
 #include <vector>
 
+#include "GpuHandle.h"
+#include "HiZPyramid.h"
+#include "IndirectRenderer.h"
+#include "InstanceBatcher.h"
+#include "ParallelRecorder.h"
+#include "RenderGraph.h"
+#include "RenderQueue.h"
+#include "common/FrameLimiter.h"
+#include "common/FrameStats.h"
+#include "common/FrustumCuller.h"
+#include "common/LinearAllocator.h"
+#include "common/SceneGraph.h"
 #include "gfx/Camera.h"
 #include "gpu_resources/DepthImage.h"
+#include "gpu_resources/UniformRing.h"
+#include "objects/EntityStore.h"
 #include "objects/Model.h"
 #include "objects/prefabs/Cube.h"
 #include "pipeline/Pipeline.h"
 
 class VK {
    public:
-    explicit VK(SDL_Window* window);
+    static constexpr uint32_t defaultFramesInFlight = 2;
+    static constexpr uint32_t maxFramesInFlight = 3;
+
+    // framesInFlight is clamped to [1, maxFramesInFlight]
+    explicit VK(SDL_Window* window, uint32_t framesInFlight = defaultFramesInFlight);
     void run();
 
+    // Falls back to FIFO (always supported) when the mode isn't available, applied on the next frame
+    void setPresentMode(VkPresentModeKHR presentMode);
+
+    // 0 uncaps the frame rate
+    void setFrameRateLimit(double fps);
+
+    // Last frame's CPU culling, empty when culling on the GPU
+    [[nodiscard]]
+    const CullStats& getCullStats() const;
+
    private:
     SDL_Window* m_window = nullptr;
 
@@ -24,12 +52,13 @@ class VK {
     VkSurfaceKHR m_surface = VK_NULL_HANDLE;
 
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
-    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;  // Null with dynamic rendering
+
+    // VK_KHR_dynamic_rendering: no render pass nor framebuffers, the scene pass renders to the image views
+    bool m_dynamicRendering = false;
 
-    struct Pipelines {
-        std::unique_ptr<Pipeline> scene;
-        std::unique_ptr<Pipeline> skybox;
-    } m_pipelines;
+    // Chosen before the swap chain exists and never modified after, read by the pipeline factories' threads
+    Pipeline::RenderTarget m_pipelineTarget;
 
     VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> m_swapChainImages;
@@ -38,26 +67,84 @@ class VK {
     VkExtent2D m_swapChainExtent{};
     std::vector<VkFramebuffer> m_framebuffers;
 
-    std::vector<VkCommandBuffer> m_commandBuffers;
-    std::vector<VkSemaphore> m_imageAvailableSemaphores;
-    std::vector<VkSemaphore> m_renderFinishedSemaphores;
-    std::vector<VkFence> m_inFlightFences;
+    // Everything the CPU writes while recording a frame, so that frame N+1 can be
+    // recorded while the GPU is still executing frame N.
+    struct FrameResources {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkSemaphore imageAvailable = VK_NULL_HANDLE;
+        VkSemaphore renderFinished = VK_NULL_HANDLE;
+        VkFence inFlight = VK_NULL_HANDLE;
+
+        uint64_t submissions = 0;  // DeletionQueue submission count once this frame completes
+        uint32_t cameraUniformOffset = 0;
+    };
+
+    uint32_t m_framesInFlight;
+    std::vector<FrameResources> m_frames;
+    std::vector<VkFence> m_imagesInFlight;  // Fence of the frame last rendering to each swap chain image
     uint32_t m_currentFrame = 0;
 
-    std::unique_ptr<DepthImage> m_depthImage;
+    VkPresentModeKHR m_requestedPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    bool m_swapChainDirty = false;
+
+    FrameLimiter m_frameLimiter;
+    FrameStats m_frameStats;
+    FrameLimiter::Clock::time_point m_lastPresent{};
+    FrameLimiter::Clock::time_point m_lastStatsReport{};
+
+    GpuHandle<DepthImage> m_depthImage;
+    RenderGraph::ResourceState m_depthState;
+
+    // Rebuilt every frame, imported resources keep their state in the members above and below
+    RenderGraph m_renderGraph;
 
     std::vector<Texture> m_textures;
-    std::vector<Model> m_models;
+    std::vector<Model> m_models;  // Loaded meshes and materials, drawn through their entities
+
+    // Entities are placed relative to a scene graph node
+    SceneGraph m_sceneGraph;
+    EntityStore m_entities;
+    FrustumCuller m_frustumCuller;
     std::unique_ptr<Cube> m_skybox;
 
     std::unique_ptr<Camera> m_camera;
 
+    std::unique_ptr<UniformRing> m_uniformRing;
+
+    std::unique_ptr<ThreadPool> m_recordingThreads;
+    std::unique_ptr<ParallelRecorder> m_parallelRecorder;
+
+    // Culls and draws models on the GPU when supported, toggled with F5
+    std::unique_ptr<IndirectRenderer> m_indirectRenderer;
+    bool m_gpuDriven = false;
+
+    // GPU path only: objects hidden behind last frame's depth are culled, toggled with F6
+    std::unique_ptr<HiZPyramid> m_hiZPyramid;
+    RenderGraph::ResourceState m_hiZState;
+    bool m_occlusionCulling = true;
+    bool m_depthHistoryValid = false;  // The depth image holds a rendered frame
+    glm::mat4 m_previousViewProjection{ 1.0f };
+
+    std::unique_ptr<InstanceBatcher> m_instanceBatcher;
+
+    // Rebuilt and sorted every frame, its storage lives in the frame allocator
+    LinearAllocator m_frameAllocator;
+    std::unique_ptr<RenderQueue> m_renderQueue;
+
     VkDescriptorSetLayout m_sceneDescriptorSetLayout = VK_NULL_HANDLE;
     VkDescriptorSetLayout m_textureDescriptorSetLayout = VK_NULL_HANDLE;
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
 
     void m_mainLoop();
     void m_drawFrame();
+    void m_reportFrameStats();
+    void m_updateSceneGraph();
+    // One entity per primitive of every mesh node, attached to that node. The model, loaded from `loader`,
+    // must outlive them.
+    void m_spawnModel(const Model& model, const GLTFLoader& loader);
+    void m_cullEntities();
+    void m_buildRenderQueue();
 
     // VK stuff
     [[nodiscard]]
@@ -72,14 +159,27 @@ class VK {
     [[nodiscard]]
     VkExtent2D m_chooseSurfaceExtent(const VkSurfaceCapabilitiesKHR& capabilities) const;
 
-    void m_createSwapChain();
-    void m_destroySwapChain() const;
+    void m_createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+    void m_retireSwapChain();
     void m_recreateSwapChain();
     void m_createImageViews();
 
     void m_createRenderPass();
     void m_createDescriptorSetLayout();
     void m_createGraphicsPipeline();
+
+    // Thread safe, only reads the pipeline layout and render pass. The scene pipeline reads per-object data
+    // from set 2, see InstanceBatcher / IndirectRenderer
+    [[nodiscard]]
+    std::unique_ptr<Pipeline> m_buildGraphicsPipeline(
+        const char* vertexShaderPath, const char* fragmentShaderPath, bool isOpaque,
+        const VkSpecializationInfo* fragmentSpecialization = nullptr) const;
+
+    void m_requestScenePipeline(MaterialFeatures features);
+
+    // Requests the permutation on first sight, the generic one is used until it is ready
+    [[nodiscard]]
+    const Pipeline* m_getScenePipeline(MaterialFeatures features);
     void m_createFramebuffers();
 
     void m_createCommandBuffers();
@@ -91,9 +191,10 @@ class VK {
     void m_createDescriptorPool();
     // void m_createDescriptorSets();
 
-    void m_recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
-    void m_drawModels(VkCommandBuffer commandBuffer) const;
+    void m_recordCommandBuffer(const FrameResources& frame, uint32_t imageIndex);
+    void m_recordScenePass(const VkCommandBuffer& commandBuffer, const FrameResources& frame,
+                           uint32_t imageIndex) const;
 
     void m_initVulkan();
-    void m_destroyVulkan() const;
+    void m_destroyVulkan();
 };
@@ -3,8 +3,9 @@
 #include "gfx/vk/OneTimeCommand.h"
 #include "gfx/vk/vkutil.h"
 
-Buffer::Buffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties)
-    : m_size(size) {
+Buffer::Buffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties,
+               const MemoryCategory category)
+    : m_size(size), m_usage(usage), m_category(category) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = m_size;
@@ -22,11 +23,17 @@ Buffer::Buffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const Vk
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
     allocInfo.memoryTypeIndex = vkContext.getPhysicalDevice().findMemoryType(memRequirements.memoryTypeBits, properties);
+    m_memoryProperties =
+        vkContext.getPhysicalDevice().getMemoryProperties().memoryTypes[allocInfo.memoryTypeIndex].propertyFlags;
 
     VK_CHECK("failed to allocate vertex buffer memory",
              vkAllocateMemory(vkContext.getDevice(), &allocInfo, nullptr, &m_bufferMemory));
 
     vkBindBufferMemory(vkContext.getDevice(), m_buffer, m_bufferMemory, 0);
+
+    m_allocationSize = allocInfo.allocationSize;
+    m_memoryTypeIndex = allocInfo.memoryTypeIndex;
+    MemoryTracker::get().onAllocate(m_category, m_allocationSize, m_memoryTypeIndex);
 }
 
 void Buffer::destroy() const {
@@ -34,6 +41,8 @@ void Buffer::destroy() const {
 
     vkFreeMemory(device, m_bufferMemory, nullptr);
     vkDestroyBuffer(device, m_buffer, nullptr);
+
+    MemoryTracker::get().onFree(m_category, m_allocationSize, m_memoryTypeIndex);
 }
 
 VkDeviceSize Buffer::getSize() const {
@@ -48,6 +57,10 @@ const VkDeviceMemory& Buffer::getMemory() const {
     return m_bufferMemory;
 }
 
+VkMemoryPropertyFlags Buffer::getMemoryProperties() const {
+    return m_memoryProperties;
+}
+
 void *Buffer::map() const {
     void* ptr;
     vkMapMemory(VulkanContext::get().getDevice(), m_bufferMemory, 0, m_size, 0, &ptr);
@@ -59,6 +72,20 @@ void Buffer::unmap() const {
     vkUnmapMemory(VulkanContext::get().getDevice(), m_bufferMemory);
 }
 
+void Buffer::flush(const VkDeviceSize offset, const VkDeviceSize size) const {
+    if (m_memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+        return;
+    }
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = m_bufferMemory;
+    range.offset = offset;
+    range.size = size;
+
+    VK_CHECK("failed to flush mapped memory", vkFlushMappedMemoryRanges(VulkanContext::get().getDevice(), 1, &range));
+}
+
 void Buffer::setMemory(const void* src, const VkDeviceSize offset, const VkMemoryMapFlags flags) const {
     const VkDevice& device = VulkanContext::get().getDevice();
     void* data;
@@ -69,26 +96,75 @@ void Buffer::setMemory(const void* src, const VkDeviceSize offset, const VkMemor
 }
 
 void Buffer::copyTo(const Buffer& dst) const {
-    const OneTimeCommand cmd(VulkanContext::get().getGraphicsQueue());
+    const VulkanContext& vkContext = VulkanContext::get();
+    const OneTimeCommand cmd(vkContext.getTransferQueue(), vkContext.getTransferCommandPool());
+
+    copyTo(cmd.buffer, dst, 0, 0, m_size);
+    dst.releaseToGraphics(cmd.buffer);
+}
 
+void Buffer::copyTo(const VkCommandBuffer& commandBuffer, const Buffer& dst, const VkDeviceSize srcOffset,
+                    const VkDeviceSize dstOffset, const VkDeviceSize size) const {
     VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = m_size;
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
 
-    vkCmdCopyBuffer(cmd.buffer, m_buffer, dst.buffer(), 1, &copyRegion);
+    vkCmdCopyBuffer(commandBuffer, m_buffer, dst.buffer(), 1, &copyRegion);
 }
 
-void Buffer::copyTo(const Texture& texture, const uint32_t layerCount) const {
-    const OneTimeCommand cmd(VulkanContext::get().getGraphicsQueue());
-
+void Buffer::copyTo(const VkCommandBuffer& commandBuffer, const Image& image, const uint32_t layerCount) const {
     VkBufferImageCopy region{};
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     region.imageSubresource.layerCount = layerCount;
-    region.imageExtent = texture.getImage().getExtent();
+    region.imageExtent = image.getExtent();
+
+    vkCmdCopyBufferToImage(commandBuffer, m_buffer, image.getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
 
-    vkCmdCopyBufferToImage(cmd.buffer, m_buffer, texture.getImage().getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
-                           &region);
+void Buffer::releaseToGraphics(const VkCommandBuffer& commandBuffer, const VkDeviceSize offset,
+                               const VkDeviceSize size) const {
+    VulkanContext& vkContext = VulkanContext::get();
+    if (!vkContext.hasDedicatedTransferQueue()) {
+        return;
+    }
+
+    const QueueFamilyIndices& indices = vkContext.getPhysicalDevice().getQueueFamilyIndices();
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_NONE;
+    barrier.srcQueueFamilyIndex = indices.transferFamily.value();
+    barrier.dstQueueFamilyIndex = indices.graphicsFamily.value();
+    barrier.buffer = m_buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                         nullptr, 1, &barrier, 0, nullptr);
+
+    // Acquire side: make the data visible to whatever will consume this buffer
+    VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_NONE;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    if (m_usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+        dstStage |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        barrier.dstAccessMask |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    }
+
+    if (m_usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+        dstStage |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        barrier.dstAccessMask |= VK_ACCESS_INDEX_READ_BIT;
+    }
+
+    if (m_usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        dstStage |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        barrier.dstAccessMask |= VK_ACCESS_UNIFORM_READ_BIT;
+    }
+
+    vkContext.enqueueAcquire(barrier, dstStage);
 }
 
 void Buffer::update(const VkCommandBuffer& cmdBuffer, const void* data) const {
@@ -2,11 +2,12 @@
 
 #include <vulkan/vulkan_core.h>
 
-#include "Texture.h"
+#include "Image.h"
+#include "gfx/vk/MemoryTracker.h"
 
 class Buffer {
    public:
-    Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category);
 
     void destroy() const;
 
@@ -19,17 +20,37 @@ class Buffer {
     [[nodiscard]]
     const VkDeviceMemory& getMemory() const;
 
+    // Actual flags of the memory type backing this buffer, may be a superset of what was requested
+    [[nodiscard]]
+    VkMemoryPropertyFlags getMemoryProperties() const;
+
     [[nodiscard]]
     void *map() const;
     void unmap() const;
 
+    // Makes host writes visible to the device, no-op on HOST_COHERENT memory
+    void flush(VkDeviceSize offset, VkDeviceSize size) const;
+
     void setMemory(const void* src, VkDeviceSize offset = 0, VkMemoryMapFlags flags = 0) const;
     void update(const VkCommandBuffer& cmdBuffer, const void* data) const;
+    // Upload on the transfer queue, completes before the next frame: this buffer must be retired, not destroyed
     void copyTo(const Buffer& dst) const;
-    void copyTo(const Texture& texture, uint32_t layerCount) const;
+    void copyTo(const VkCommandBuffer& commandBuffer, const Buffer& dst, VkDeviceSize srcOffset,
+                VkDeviceSize dstOffset, VkDeviceSize size) const;
+    void copyTo(const VkCommandBuffer& commandBuffer, const Image& image, uint32_t layerCount) const;
+
+    // Release half of a transfer -> graphics ownership transfer, no-op without a dedicated transfer queue
+    void releaseToGraphics(const VkCommandBuffer& commandBuffer, VkDeviceSize offset = 0,
+                           VkDeviceSize size = VK_WHOLE_SIZE) const;
 
    private:
     const VkDeviceSize m_size;
+    const VkBufferUsageFlags m_usage;
+    VkMemoryPropertyFlags m_memoryProperties = 0;
+
+    const MemoryCategory m_category;
+    VkDeviceSize m_allocationSize = 0;
+    uint32_t m_memoryTypeIndex = 0;
 
     VkBuffer m_buffer = VK_NULL_HANDLE;
     VkDeviceMemory m_bufferMemory = VK_NULL_HANDLE;
@@ -0,0 +1,108 @@
+#include "GeometryArena.h"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "gfx/vk/OneTimeCommand.h"
+
+GeometryArena& GeometryArena::get() {
+    static GeometryArena shared;
+    return shared;
+}
+
+void GeometryArena::init(const uint32_t vertexCapacity, const uint32_t indexCapacity) {
+    m_vertexBuffer = makeGpuHandle<Buffer>(
+        sizeof(Vertex) * vertexCapacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Geometry);
+
+    m_indexBuffer = makeGpuHandle<Buffer>(sizeof(uint32_t) * indexCapacity,
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Geometry);
+
+    m_vertexAllocator = std::make_unique<FreeListAllocator>(vertexCapacity);
+    m_indexAllocator = std::make_unique<FreeListAllocator>(indexCapacity);
+}
+
+void GeometryArena::destroy() {
+    m_vertexBuffer.reset();
+    m_indexBuffer.reset();
+
+    // Retired mesh ranges still free() themselves into the allocators, which go after them
+    DeletionQueue::get().retire([this] {
+        m_vertexAllocator.reset();
+        m_indexAllocator.reset();
+    });
+}
+
+MeshRange GeometryArena::upload(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    const std::optional<uint64_t> vertexOffset = m_vertexAllocator->allocate(vertices.size());
+    if (!vertexOffset.has_value()) {
+        throw std::runtime_error(fmt::format("geometry arena: out of vertex space ({} requested, {}/{} used)",
+                                             vertices.size(), m_vertexAllocator->getUsed(),
+                                             m_vertexAllocator->getCapacity()));
+    }
+
+    const std::optional<uint64_t> firstIndex = m_indexAllocator->allocate(indices.size());
+    if (!firstIndex.has_value()) {
+        m_vertexAllocator->free(vertexOffset.value(), vertices.size());
+        throw std::runtime_error(fmt::format("geometry arena: out of index space ({} requested, {}/{} used)",
+                                             indices.size(), m_indexAllocator->getUsed(),
+                                             m_indexAllocator->getCapacity()));
+    }
+
+    MeshRange range{};
+    range.vertexOffset = static_cast<int32_t>(vertexOffset.value());
+    range.vertexCount = vertices.size();
+    range.firstIndex = firstIndex.value();
+    range.indexCount = indices.size();
+
+    // Vertices and indices share a single staging buffer and a single submission
+    const VkDeviceSize verticesSize = sizeof(Vertex) * vertices.size();
+    const VkDeviceSize indicesSize = sizeof(uint32_t) * indices.size();
+    // Retired when it goes out of scope
+    const GpuHandle<Buffer> stagingBuffer = makeGpuHandle<Buffer>(
+        verticesSize + indicesSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging);
+
+    auto* data = static_cast<uint8_t*>(stagingBuffer->map());
+    memcpy(data, vertices.data(), verticesSize);
+    memcpy(data + verticesSize, indices.data(), indicesSize);
+    stagingBuffer->unmap();
+
+    {
+        const VulkanContext& vkContext = VulkanContext::get();
+        const OneTimeCommand cmd(vkContext.getTransferQueue(), vkContext.getTransferCommandPool());
+
+        const VkDeviceSize vertexDstOffset = sizeof(Vertex) * range.vertexOffset;
+        const VkDeviceSize indexDstOffset = sizeof(uint32_t) * range.firstIndex;
+
+        stagingBuffer->copyTo(cmd.buffer, *m_vertexBuffer, 0, vertexDstOffset, verticesSize);
+        stagingBuffer->copyTo(cmd.buffer, *m_indexBuffer, verticesSize, indexDstOffset, indicesSize);
+
+        m_vertexBuffer->releaseToGraphics(cmd.buffer, vertexDstOffset, verticesSize);
+        m_indexBuffer->releaseToGraphics(cmd.buffer, indexDstOffset, indicesSize);
+    }
+
+    return range;
+}
+
+void GeometryArena::free(const MeshRange& range) {
+    m_vertexAllocator->free(range.vertexOffset, range.vertexCount);
+    m_indexAllocator->free(range.firstIndex, range.indexCount);
+}
+
+void GeometryArena::bind(const VkCommandBuffer& commandBuffer) const {
+    constexpr VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer->buffer(), &offset);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer->buffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+const Buffer& GeometryArena::getVertexBuffer() const {
+    return *m_vertexBuffer;
+}
+
+const Buffer& GeometryArena::getIndexBuffer() const {
+    return *m_indexBuffer;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+#include <vector>
+
+#include "Buffer.h"
+#include "common/FreeListAllocator.h"
+#include "gfx/vk/GpuHandle.h"
+#include "gfx/vk/types/Vertex.h"
+
+// Where a mesh lives inside the shared vertex/index buffers
+struct MeshRange {
+    int32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// Every mesh is sub-allocated from one device local vertex buffer and one index buffer,
+// so they only have to be bound once per frame.
+class GeometryArena {
+   public:
+    static GeometryArena& get();
+
+    void init(uint32_t vertexCapacity, uint32_t indexCapacity);
+    // Retires the buffers, after the mesh ranges retired so far: DeletionQueue::flush() must follow
+    void destroy();
+
+    [[nodiscard]]
+    MeshRange upload(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    void free(const MeshRange& range);
+
+    void bind(const VkCommandBuffer& commandBuffer) const;
+
+    [[nodiscard]]
+    const Buffer& getVertexBuffer() const;
+
+    [[nodiscard]]
+    const Buffer& getIndexBuffer() const;
+
+   private:
+    GeometryArena() = default;
+
+    GpuHandle<Buffer> m_vertexBuffer;
+    GpuHandle<Buffer> m_indexBuffer;
+
+    std::unique_ptr<FreeListAllocator> m_vertexAllocator;
+    std::unique_ptr<FreeListAllocator> m_indexAllocator;
+};
@@ -4,9 +4,14 @@
 #include "gfx/vk/vkutil.h"
 
 Image::Image(const VkExtent3D& extent, const VkFormat format, const VkImageTiling tiling, const VkImageUsageFlags usage,
-             const VkMemoryPropertyFlags properties, const VkImageAspectFlags aspectFlags,
-             const VkImageViewType viewType, const uint32_t mipLevels, const uint32_t layers)
-    : m_extent(extent), m_layout(VK_IMAGE_LAYOUT_UNDEFINED), m_mipLevels(mipLevels), m_layers(layers) {
+             const VkMemoryPropertyFlags properties, const MemoryCategory category,
+             const VkImageAspectFlags aspectFlags, const VkImageViewType viewType, const uint32_t mipLevels,
+             const uint32_t layers)
+    : m_extent(extent),
+      m_layout(VK_IMAGE_LAYOUT_UNDEFINED),
+      m_mipLevels(mipLevels),
+      m_layers(layers),
+      m_category(category) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -43,6 +48,10 @@ Image::Image(const VkExtent3D& extent, const VkFormat format, const VkImageTilin
 
     vkBindImageMemory(vkContext.getDevice(), m_image, m_deviceMemory, 0);
 
+    m_allocationSize = allocInfo.allocationSize;
+    m_memoryTypeIndex = allocInfo.memoryTypeIndex;
+    MemoryTracker::get().onAllocate(m_category, m_allocationSize, m_memoryTypeIndex);
+
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = m_image;
@@ -63,11 +72,16 @@ void Image::destroy() const {
     vkFreeMemory(device, m_deviceMemory, nullptr);
     vkDestroyImageView(device, m_imageView, nullptr);
     vkDestroyImage(device, m_image, nullptr);
+
+    MemoryTracker::get().onFree(m_category, m_allocationSize, m_memoryTypeIndex);
 }
 
 void Image::transitionLayout(const VkImageLayout newLayout) {
     const OneTimeCommand cmd(VulkanContext::get().getGraphicsQueue());
+    transitionLayout(cmd.buffer, newLayout);
+}
 
+void Image::transitionLayout(const VkCommandBuffer& commandBuffer, const VkImageLayout newLayout) {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = m_layout;
@@ -75,21 +89,7 @@ void Image::transitionLayout(const VkImageLayout newLayout) {
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = m_image;
-
-    if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-        // if (hasStencilComponent(format)) {
-        //     barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-        // }
-    } else {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    }
-
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = m_mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = m_layers;
+    barrier.subresourceRange = m_getSubresourceRange(newLayout);
 
     VkPipelineStageFlags sourceStage;
     VkPipelineStageFlags destinationStage;
@@ -114,15 +114,76 @@ void Image::transitionLayout(const VkImageLayout newLayout) {
 
         sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
         destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    } else if (m_layout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     } else {
         throw std::invalid_argument("unsupported layout transition!");
     }
 
-    vkCmdPipelineBarrier(cmd.buffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    m_layout = newLayout;
+}
+
+void Image::releaseToGraphics(const VkCommandBuffer& commandBuffer, const VkImageLayout newLayout) {
+    VulkanContext& vkContext = VulkanContext::get();
+    if (!vkContext.hasDedicatedTransferQueue()) {
+        transitionLayout(commandBuffer, newLayout);
+        return;
+    }
+
+    if (m_layout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL || newLayout != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        throw std::invalid_argument("unsupported ownership transfer!");
+    }
+
+    const QueueFamilyIndices& indices = vkContext.getPhysicalDevice().getQueueFamilyIndices();
+
+    // Both halves must describe the same layout transition, it is only executed once
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = m_layout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = indices.transferFamily.value();
+    barrier.dstQueueFamilyIndex = indices.graphicsFamily.value();
+    barrier.image = m_image;
+    barrier.subresourceRange = m_getSubresourceRange(newLayout);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_NONE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = VK_ACCESS_NONE;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkContext.enqueueAcquire(barrier, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
     m_layout = newLayout;
 }
 
+VkImageSubresourceRange Image::m_getSubresourceRange(const VkImageLayout layout) const {
+    VkImageSubresourceRange range{};
+    if (layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+        range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+        // if (hasStencilComponent(format)) {
+        //     range.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        // }
+    } else {
+        range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+
+    range.baseMipLevel = 0;
+    range.levelCount = m_mipLevels;
+    range.baseArrayLayer = 0;
+    range.layerCount = m_layers;
+
+    return range;
+}
+
 const VkExtent3D& Image::getExtent() const {
     return m_extent;
 }
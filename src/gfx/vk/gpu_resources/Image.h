@@ -3,14 +3,21 @@
 #include <vulkan/vulkan_core.h>
 
 #include "../types/VulkanContext.h"
+#include "gfx/vk/MemoryTracker.h"
 
 class Image {
    public:
     explicit Image(const VkExtent3D& extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                   VkMemoryPropertyFlags properties, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t mipLevels = 1, uint32_t layers = 1);
+                   VkMemoryPropertyFlags properties, MemoryCategory category, VkImageAspectFlags aspectFlags,
+                   VkImageViewType viewType, uint32_t mipLevels = 1, uint32_t layers = 1);
 
     void destroy() const;
     void transitionLayout(VkImageLayout newLayout);
+    void transitionLayout(const VkCommandBuffer& commandBuffer, VkImageLayout newLayout);
+
+    // Transitions to newLayout while handing the image over from the transfer queue to the graphics queue.
+    // Without a dedicated transfer queue this is a regular transition.
+    void releaseToGraphics(const VkCommandBuffer& commandBuffer, VkImageLayout newLayout);
 
     [[nodiscard]]
     const VkExtent3D& getExtent() const;
@@ -25,6 +32,9 @@ class Image {
     VkImageView getImageView() const;
 
    protected:
+    [[nodiscard]]
+    VkImageSubresourceRange m_getSubresourceRange(VkImageLayout layout) const;
+
     VkImage m_image = VK_NULL_HANDLE;
     VkDeviceMemory m_deviceMemory = VK_NULL_HANDLE;
     VkImageView m_imageView = VK_NULL_HANDLE;
@@ -34,4 +44,8 @@ class Image {
 
     uint32_t m_mipLevels;
     uint32_t m_layers;
+
+    MemoryCategory m_category;
+    VkDeviceSize m_allocationSize = 0;
+    uint32_t m_memoryTypeIndex = 0;
 };
@@ -17,6 +17,7 @@ PhysicalDevice::PhysicalDevice(const VkPhysicalDevice& physicalDevice, const VkS
 
     vkGetPhysicalDeviceProperties(m_underlying, &m_properties);
     vkGetPhysicalDeviceFeatures(m_underlying, &m_features);
+    vkGetPhysicalDeviceMemoryProperties(m_underlying, &m_memoryProperties);
 
     m_findQueueFamilies(surface);
     m_querySwapChainSupport(surface);
@@ -34,18 +35,30 @@ void PhysicalDevice::m_findQueueFamilies(const VkSurfaceKHR &surface) {
 
     uint32_t i = 0;
     for (const VkQueueFamilyProperties &queueFamily : queueFamilies) {
-        if (m_queueFamilies.isValid()) {
-            break;  // We have found every required indices
+        if (!m_queueFamilies.graphicsFamily.has_value() && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            m_queueFamilies.graphicsFamily = i;
         }
 
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            m_queueFamilies.graphicsFamily = i;
+        if (!m_queueFamilies.presentFamily.has_value()) {
+            VkBool32 isSupported;
+            vkGetPhysicalDeviceSurfaceSupportKHR(m_underlying, i, surface, &isSupported);
+            if (isSupported) {
+                m_queueFamilies.presentFamily = i;
+            }
         }
 
-        VkBool32 isSupported;
-        vkGetPhysicalDeviceSurfaceSupportKHR(m_underlying, i, surface, &isSupported);
-        if (isSupported) {
-            m_queueFamilies.presentFamily = i;
+        // A transfer-only family maps to the DMA engines on most discrete GPUs.
+        // Families without compute are preferred as they are the "purest" copy queues.
+        const bool isTransferOnly =
+            (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+        if (isTransferOnly) {
+            const bool isBetter =
+                !m_queueFamilies.transferFamily.has_value() ||
+                (queueFamilies[m_queueFamilies.transferFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT &&
+                 !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT));
+            if (isBetter) {
+                m_queueFamilies.transferFamily = i;
+            }
         }
 
         ++i;
@@ -117,15 +130,12 @@ bool PhysicalDevice::supportsExtensions(const std::vector<const char *> &require
 }
 
 uint32_t PhysicalDevice::findMemoryType(const uint32_t type, const VkMemoryPropertyFlags properties) const {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_underlying, &memProperties);
-
-    for (int i = 0; i < memProperties.memoryTypeCount; ++i) {
+    for (int i = 0; i < m_memoryProperties.memoryTypeCount; ++i) {
         if (!(type & (1 << i))) {
             continue;
         }
 
-        if ((memProperties.memoryTypes[i].propertyFlags & properties) != properties) {
+        if ((m_memoryProperties.memoryTypes[i].propertyFlags & properties) != properties) {
             continue;
         }
 
@@ -143,6 +153,14 @@ const VkPhysicalDeviceProperties &PhysicalDevice::getProperties() const {
     return m_properties;
 }
 
+const VkPhysicalDeviceFeatures &PhysicalDevice::getFeatures() const {
+    return m_features;
+}
+
+const VkPhysicalDeviceMemoryProperties &PhysicalDevice::getMemoryProperties() const {
+    return m_memoryProperties;
+}
+
 const QueueFamilyIndices &PhysicalDevice::getQueueFamilyIndices() const {
     return m_queueFamilies;
 }
@@ -8,15 +8,26 @@
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily;  // Only set when a transfer-only family exists
 
     [[nodiscard]]
     bool isValid() const {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
 
+    [[nodiscard]]
+    bool hasDedicatedTransfer() const {
+        return transferFamily.has_value() && transferFamily.value() != graphicsFamily.value();
+    }
+
     [[nodiscard]]
     std::set<uint32_t> getUnique() const {
-        return { graphicsFamily.value(), presentFamily.value() };
+        std::set<uint32_t> unique = { graphicsFamily.value(), presentFamily.value() };
+        if (transferFamily.has_value()) {
+            unique.insert(transferFamily.value());
+        }
+
+        return unique;
     }
 };
 
@@ -36,6 +47,8 @@ public:
 
     const VkPhysicalDevice& getUnderlying() const;
     const VkPhysicalDeviceProperties& getProperties() const;
+    const VkPhysicalDeviceFeatures& getFeatures() const;
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const;
     const QueueFamilyIndices& getQueueFamilyIndices() const;
     const SwapChainSupportDetails& getSwapChainSupportDetails() const;
 
@@ -47,6 +60,7 @@ private:
 
     std::vector<VkExtensionProperties> m_extensions;
     VkPhysicalDeviceProperties m_properties;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties;
     VkPhysicalDeviceFeatures m_features;
 
     QueueFamilyIndices m_queueFamilies;
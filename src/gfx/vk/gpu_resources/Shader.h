@@ -6,12 +6,18 @@
 #include <vector>
 
 #include "../types/VulkanContext.h"
+#include "ShaderCache.h"
 
 class Shader {
    public:
-    enum Type { Vertex = shaderc_vertex_shader, Fragment = shaderc_fragment_shader };
+    enum Type {
+        Vertex = shaderc_vertex_shader,
+        Fragment = shaderc_fragment_shader,
+        Compute = shaderc_compute_shader,
+    };
 
-    explicit Shader(const char *path, Type shaderType);
+    // SPIR-V comes from the ShaderCache, compiled on a miss
+    explicit Shader(const char *path, Type shaderType, const ShaderCache::Defines &defines = {});
 
     void destroy() const;
 
@@ -29,6 +35,5 @@ class Shader {
     VkShaderModule m_module = VK_NULL_HANDLE;
     const char *m_entrypoint = "main";
 
-    void m_compile(const std::string &glslString);
     void m_createModule();
 };
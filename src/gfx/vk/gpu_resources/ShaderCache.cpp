@@ -0,0 +1,323 @@
+#include "ShaderCache.h"
+
+#include <fmt/format.h>
+#include <vulkan/vulkan_core.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "common/ThreadPool.h"
+
+#if __has_include(<glslang/build_info.h>)
+#include <glslang/build_info.h>
+constexpr uint32_t glslangVersion = GLSLANG_VERSION_MAJOR << 20 | GLSLANG_VERSION_MINOR << 10 | GLSLANG_VERSION_PATCH;
+#else
+constexpr uint32_t glslangVersion = 0;
+#endif
+
+// Bump when the way shaders are compiled changes (options, includer...)
+constexpr uint32_t cacheFormatVersion = 1;
+
+// shaderc has no version query. It ships with the Vulkan SDK, whose version stands for the compiler build,
+// along with glslang's when its headers are installed.
+constexpr uint32_t sdkVersion = VK_HEADER_VERSION_COMPLETE;
+constexpr uint32_t spirvMagic = 0x07230203;
+
+namespace {
+std::string readTextFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error(fmt::format("Unable to open {}", path));
+    }
+
+    return { std::istreambuf_iterator(file), std::istreambuf_iterator<char>() };
+}
+
+// FNV-1a
+class Hasher {
+   public:
+    void add(const void* data, const size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            m_hash ^= bytes[i];
+            m_hash *= 0x100000001b3;
+        }
+    }
+
+    void add(const std::string& string) {
+        const uint64_t size = string.size();
+        add(&size, sizeof(size));  // "ab" + "c" and "a" + "bc" must differ
+        add(string.data(), string.size());
+    }
+
+    [[nodiscard]]
+    uint64_t getHash() const {
+        return m_hash;
+    }
+
+   private:
+    uint64_t m_hash = 0xcbf29ce484222325;
+};
+
+std::filesystem::path resolveInclude(const std::string& requested, const std::string& requesting) {
+    return std::filesystem::path(requesting).parent_path() / requested;
+}
+
+// Hashes `source` and, recursively, every file it includes. Textual scan: conditionally included files
+// are always part of the key, which can only cause spurious misses.
+void hashWithIncludes(Hasher& hasher, const std::string& path, const std::string& source,
+                      std::vector<std::string>& dependencies, const uint32_t depth) {
+    static const std::regex includePattern(R"(^\s*#\s*include\s*[<"]([^>"]+)[>"])");
+
+    if (depth > 32) {
+        throw std::runtime_error(fmt::format("Include depth exceeded in {}", path));
+    }
+
+    hasher.add(source);
+    dependencies.push_back(std::filesystem::path(path).lexically_normal().string());
+
+    std::istringstream lines(source);
+    std::string line;
+    std::smatch match;
+    while (std::getline(lines, line)) {
+        if (std::regex_search(line, match, includePattern)) {
+            const std::string includePath = resolveInclude(match[1].str(), path).string();
+            hashWithIncludes(hasher, includePath, readTextFile(includePath), dependencies, depth + 1);
+        }
+    }
+}
+
+// #include "file" and <file>, both relative to the including file
+class FileIncluder : public shaderc::CompileOptions::IncluderInterface {
+   public:
+    shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type,
+                                       const char* requestingSource, size_t) override {
+        auto* include = new Include();
+        include->name = resolveInclude(requestedSource, requestingSource).string();
+
+        try {
+            include->content = readTextFile(include->name);
+        } catch (const std::runtime_error& error) {
+            // An empty source name tells shaderc the include failed, the content is the error
+            include->content = error.what();
+            include->name.clear();
+        }
+
+        include->result.source_name = include->name.c_str();
+        include->result.source_name_length = include->name.size();
+        include->result.content = include->content.c_str();
+        include->result.content_length = include->content.size();
+        include->result.user_data = include;
+
+        return &include->result;
+    }
+
+    void ReleaseInclude(shaderc_include_result* result) override {
+        delete static_cast<Include*>(result->user_data);
+    }
+
+   private:
+    struct Include {
+        std::string name;
+        std::string content;
+        shaderc_include_result result{};
+    };
+};
+}  // namespace
+
+ShaderCache& ShaderCache::get() {
+    static ShaderCache shared;
+    return shared;
+}
+
+void ShaderCache::init(const std::string& directory) {
+    m_directory = directory;
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error) {
+        fmt::println("Unable to create shader cache directory {}: {}, caching in memory only", m_directory,
+                     error.message());
+        m_directory.clear();
+    }
+}
+
+void ShaderCache::prewarm(const std::string& shaderDirectory) {
+    std::vector<Request> requests;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(shaderDirectory)) {
+        const std::string extension = entry.path().extension().string();
+        if (extension == ".vert") {
+            requests.push_back({ entry.path().string(), shaderc_vertex_shader });
+        } else if (extension == ".frag") {
+            requests.push_back({ entry.path().string(), shaderc_fragment_shader });
+        } else if (extension == ".comp") {
+            requests.push_back({ entry.path().string(), shaderc_compute_shader });
+        }
+    }
+
+    if (requests.empty()) {
+        return;
+    }
+
+    // Workers pull shaders until none is left, compile times vary a lot from one shader to another
+    std::atomic<uint32_t> next = 0;
+    ThreadPool threadPool(std::min<uint32_t>(requests.size(), std::max(1u, std::thread::hardware_concurrency())));
+    threadPool.run([&](uint32_t) {
+        for (uint32_t i = next++; i < requests.size(); i = next++) {
+            // Only a head start: a shader that needs defines, or is broken, fails again when actually used
+            try {
+                (void)getSpirv(requests[i]);
+            } catch (const std::exception& error) {
+                fmt::println("Skipped prewarming {}: {}", requests[i].path, error.what());
+            }
+        }
+    });
+}
+
+std::vector<uint32_t> ShaderCache::getSpirv(const Request& request) {
+    const std::string requestKey = m_getRequestKey(request);
+
+    uint64_t invalidations;
+    {
+        std::lock_guard lock(m_mutex);
+        if (const auto it = m_loaded.find(requestKey); it != m_loaded.end()) {
+            return it->second.spirv;
+        }
+        invalidations = m_invalidations;
+    }
+
+    const std::string source = readTextFile(request.path);
+    std::vector<std::string> dependencies;
+    const uint64_t key = m_computeKey(request, source, dependencies);
+
+    std::vector<uint32_t> spirv;
+
+    const std::string cachePath = m_getCachePath(key);
+    if (!cachePath.empty()) {
+        std::ifstream file(cachePath, std::ios::ate | std::ios::binary);
+        if (file.is_open()) {
+            const std::streamsize fileSize = file.tellg();
+            file.seekg(0);
+
+            if (fileSize > 0 && fileSize % sizeof(uint32_t) == 0) {
+                spirv.resize(fileSize / sizeof(uint32_t));
+                file.read(reinterpret_cast<char*>(spirv.data()), fileSize);
+            }
+
+            if (!file || spirv.empty() || spirv[0] != spirvMagic) {
+                fmt::println("Discarding invalid cached SPIR-V {}", cachePath);
+                spirv.clear();
+            }
+        }
+    }
+
+    if (spirv.empty()) {
+        spirv = m_compile(request, source);
+
+        if (!cachePath.empty()) {
+            // Written aside then renamed: concurrent runs and interrupted writes never expose a partial file
+            const size_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            const std::string tmpPath = fmt::format("{}.{}.tmp", cachePath, threadID);
+            {
+                std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(spirv.data()),
+                           static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+            }
+
+            std::error_code error;
+            std::filesystem::rename(tmpPath, cachePath, error);
+            if (error) {
+                fmt::println("Unable to cache {}: {}", request.path, error.message());
+                std::filesystem::remove(tmpPath, error);
+            }
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    // The sources may have changed since they were read, the next lookup reads them again
+    if (invalidations == m_invalidations) {
+        m_loaded.insert_or_assign(requestKey, Entry{ spirv, std::move(dependencies) });
+    }
+
+    return spirv;
+}
+
+void ShaderCache::invalidate(const std::vector<std::string>& changedPaths) {
+    std::lock_guard lock(m_mutex);
+    ++m_invalidations;
+
+    std::erase_if(m_loaded, [&](const auto& item) {
+        return std::ranges::any_of(item.second.dependencies, [&](const std::string& dependency) {
+            return std::ranges::find(changedPaths, dependency) != changedPaths.end();
+        });
+    });
+}
+
+std::string ShaderCache::m_getRequestKey(const Request& request) {
+    std::string key = fmt::format("{}|{}", std::filesystem::path(request.path).lexically_normal().string(),
+                                  static_cast<int>(request.kind));
+    for (const auto& [name, value] : request.defines) {
+        key += fmt::format("|{}={}", name, value);
+    }
+
+    return key;
+}
+
+uint64_t ShaderCache::m_computeKey(const Request& request, const std::string& source,
+                                   std::vector<std::string>& dependencies) {
+    Hasher hasher;
+
+    unsigned int spirvVersion = 0;
+    unsigned int spirvRevision = 0;
+    shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+
+    hasher.add(&cacheFormatVersion, sizeof(cacheFormatVersion));
+    hasher.add(&sdkVersion, sizeof(sdkVersion));
+    hasher.add(&glslangVersion, sizeof(glslangVersion));
+    hasher.add(&spirvVersion, sizeof(spirvVersion));
+    hasher.add(&spirvRevision, sizeof(spirvRevision));
+    hasher.add(&request.kind, sizeof(request.kind));
+
+    for (const auto& [name, value] : request.defines) {
+        hasher.add(name);
+        hasher.add(value);
+    }
+
+    hashWithIncludes(hasher, request.path, source, dependencies, 0);
+
+    return hasher.getHash();
+}
+
+std::vector<uint32_t> ShaderCache::m_compile(const Request& request, const std::string& source) {
+    shaderc::CompileOptions options;
+    options.SetIncluder(std::make_unique<FileIncluder>());
+    for (const auto& [name, value] : request.defines) {
+        options.AddMacroDefinition(name, value);
+    }
+
+    const shaderc::Compiler compiler;
+    const shaderc::SpvCompilationResult res =
+        compiler.CompileGlslToSpv(source, request.kind, request.path.c_str(), options);
+
+    if (res.GetCompilationStatus() != shaderc_compilation_status_success) {
+        throw std::runtime_error(fmt::format("Could not compile {}: {}", request.path, res.GetErrorMessage()));
+    }
+
+    fmt::println("Compiled {} with {} warning(s)", request.path, res.GetNumWarnings());
+    return { res.begin(), res.end() };
+}
+
+std::string ShaderCache::m_getCachePath(const uint64_t key) const {
+    if (m_directory.empty()) {
+        return {};
+    }
+
+    return fmt::format("{}/{:016x}.spv", m_directory, key);
+}
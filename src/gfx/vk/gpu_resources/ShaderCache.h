@@ -0,0 +1,68 @@
+#pragma once
+
+#include <shaderc/shaderc.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Compiled SPIR-V, cached in memory and on disk. Disk entries are keyed by a hash of the source, every file it
+// includes, the defines, the shader kind and the compiler version: editing any of them is a miss.
+// Memory entries are keyed by the request alone so that hits don't touch the disk, invalidate() drops them.
+class ShaderCache {
+   public:
+    typedef std::vector<std::pair<std::string, std::string>> Defines;  // Name, value
+
+    struct Request {
+        std::string path;
+        shaderc_shader_kind kind;
+        Defines defines;
+    };
+
+    static ShaderCache& get();
+
+    // SPIR-V files are stored in `directory`, created when missing
+    void init(const std::string& directory);
+
+    // Loads or compiles every .vert, .frag and .comp of `shaderDirectory` concurrently,
+    // later getSpirv() calls for them are memory hits
+    void prewarm(const std::string& shaderDirectory);
+
+    // Thread safe: memory, then disk, then shaderc
+    [[nodiscard]]
+    std::vector<uint32_t> getSpirv(const Request& request);
+
+    // Drops the memory entries whose source or includes are in `changedPaths` (lexically normal)
+    void invalidate(const std::vector<std::string>& changedPaths);
+
+   private:
+    struct Entry {
+        std::vector<uint32_t> spirv;
+        std::vector<std::string> dependencies;  // Source and includes, lexically normal
+    };
+
+    ShaderCache() = default;
+
+    [[nodiscard]]
+    static std::string m_getRequestKey(const Request& request);
+
+    // Appends the source and every file it includes to `dependencies`
+    [[nodiscard]]
+    static uint64_t m_computeKey(const Request& request, const std::string& source,
+                                 std::vector<std::string>& dependencies);
+
+    [[nodiscard]]
+    static std::vector<uint32_t> m_compile(const Request& request, const std::string& source);
+
+    [[nodiscard]]
+    std::string m_getCachePath(uint64_t key) const;
+
+    std::string m_directory;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_loaded;
+    uint64_t m_invalidations = 0;  // Lookups that started before an invalidation don't store their result
+};
@@ -8,6 +8,7 @@
 #include <stdexcept>
 
 #include "Buffer.h"
+#include "gfx/vk/OneTimeCommand.h"
 #include "gfx/vk/vkutil.h"
 
 Texture::Texture(const std::vector<const char *> &filenames, const VkDescriptorPool &descriptorPool,
@@ -31,8 +32,9 @@ Texture::Texture(const std::vector<const char *> &filenames, const VkDescriptorP
             // NOTE: Hoping that all layers are the same size otherwise we're f****d!
             const uint32_t bufferSize = layerSize * layersCount;
             m_stagingBuffer =
-                std::make_unique<Buffer>(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+                makeGpuHandle<Buffer>(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                      MemoryCategory::Staging);
             mappedBuffer = static_cast<uint8_t *>(m_stagingBuffer->map());
         }
 
@@ -51,16 +53,21 @@ Texture::Texture(const std::vector<const char *> &filenames, const VkDescriptorP
 
     // TODO: Is this ok?
     VkImageViewType imageViewType = layersCount == 6 ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
-    m_image = std::make_unique<Image>(extent, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-                                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
-                                      imageViewType, 1, layersCount);
-
-    m_image->transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    m_stagingBuffer->copyTo(*this, layersCount);
-    m_image->transitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    m_image = makeGpuHandle<Image>(extent, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Texture,
+                                   VK_IMAGE_ASPECT_COLOR_BIT, imageViewType, 1, layersCount);
+
+    {
+        const VulkanContext &vkContext = VulkanContext::get();
+        const OneTimeCommand cmd(vkContext.getTransferQueue(), vkContext.getTransferCommandPool());
+
+        m_image->transitionLayout(cmd.buffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        m_stagingBuffer->copyTo(cmd.buffer, *m_image, layersCount);
+        m_image->releaseToGraphics(cmd.buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
 
-    m_stagingBuffer->destroy();
+    m_stagingBuffer.reset();
 
     m_createSampler();
     m_createDescriptorSet(descriptorPool, descriptorSetLayout);
@@ -123,9 +130,11 @@ void Texture::m_createSampler() {
     VK_CHECK("failed to create sampler", vkCreateSampler(vkContext.getDevice(), &samplerInfo, nullptr, &m_sampler));
 }
 
-void Texture::destroy() const {
-    m_image->destroy();
-    vkDestroySampler(VulkanContext::get().getDevice(), m_sampler, nullptr);
+void Texture::destroy() {
+    m_image.reset();
+    DeletionQueue::get().retire(
+        [sampler = m_sampler] { vkDestroySampler(VulkanContext::get().getDevice(), sampler, nullptr); });
+    m_sampler = VK_NULL_HANDLE;
 }
 
 // void Texture::bind(const VkCommandBuffer &commandBuffer, const VkPipelineLayout &pipelineLayout) const {
@@ -3,6 +3,7 @@
 #include <memory>
 
 #include "Image.h"
+#include "gfx/vk/GpuHandle.h"
 
 class Buffer;
 
@@ -14,7 +15,8 @@ class Texture {
                      const VkDescriptorSetLayout& descriptorSetLayout);
     Texture(Texture&& other) noexcept = default;
 
-    void destroy() const;
+    // The image and sampler are retired through the DeletionQueue
+    void destroy();
 
     // void bind(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout) const;
 
@@ -40,8 +42,8 @@ class Texture {
                                const VkDescriptorSetLayout& descriptorSetLayout);
     void m_createSampler();
 
-    std::unique_ptr<Buffer> m_stagingBuffer;
-    std::unique_ptr<Image> m_image;
+    GpuHandle<Buffer> m_stagingBuffer;
+    GpuHandle<Image> m_image;
 
     VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
     VkSampler m_sampler = VK_NULL_HANDLE;
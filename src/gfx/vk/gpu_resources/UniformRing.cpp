@@ -0,0 +1,72 @@
+#include "UniformRing.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "gfx/vk/types/VulkanContext.h"
+
+UniformRing::UniformRing(const VkDeviceSize frameSize, const uint32_t frameCount) : m_frameCount(frameCount) {
+    const VkPhysicalDeviceLimits& limits = VulkanContext::get().getPhysicalDevice().getProperties().limits;
+
+    // Both limits are powers of two: aligning on the biggest satisfies dynamic offsets and flush ranges
+    m_alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.nonCoherentAtomSize);
+    m_frameSize = m_align(frameSize);
+
+    // Coherency is not requested so that any host visible type can be used, flush() handles the other case
+    m_buffer = makeGpuHandle<Buffer>(m_frameSize * m_frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Uniform);
+    m_mapped = static_cast<uint8_t*>(m_buffer->map());
+}
+
+void UniformRing::destroy() {
+    m_buffer->unmap();
+    m_buffer.reset();
+}
+
+void UniformRing::beginFrame(const uint32_t frameIndex) {
+    m_frameBegin = m_frameSize * (frameIndex % m_frameCount);
+    m_head = m_frameBegin;
+}
+
+UniformAllocation UniformRing::allocate(const VkDeviceSize size) {
+    const VkDeviceSize alignedSize = m_align(size);
+    if (m_head + alignedSize > m_frameBegin + m_frameSize) {
+        throw std::runtime_error(fmt::format("uniform ring: frame region exhausted ({} requested, {}/{} used)", size,
+                                             m_head - m_frameBegin, m_frameSize));
+    }
+
+    const UniformAllocation allocation{
+        .data = m_mapped + m_head,
+        .offset = static_cast<uint32_t>(m_head),
+    };
+
+    m_head += alignedSize;
+    return allocation;
+}
+
+void UniformRing::flush() const {
+    if (m_head == m_frameBegin) {
+        return;
+    }
+
+    m_buffer->flush(m_frameBegin, m_head - m_frameBegin);
+}
+
+const Buffer& UniformRing::getBuffer() const {
+    return *m_buffer;
+}
+
+VkDescriptorBufferInfo UniformRing::getDescriptorInfo(const VkDeviceSize range) const {
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_buffer->buffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = range;
+
+    return bufferInfo;
+}
+
+VkDeviceSize UniformRing::m_align(const VkDeviceSize size) const {
+    return (size + m_alignment - 1) & ~(m_alignment - 1);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstring>
+#include <memory>
+
+#include "Buffer.h"
+#include "gfx/vk/GpuHandle.h"
+
+struct UniformAllocation {
+    void* data = nullptr;
+    uint32_t offset = 0;  // Dynamic offset to pass to vkCmdBindDescriptorSets
+};
+
+// Persistently mapped uniform buffer split in one region per frame in flight.
+// Each frame linearly allocates transient constants from its own region, which is only
+// rewritten once the fence of that frame has been waited on.
+class UniformRing {
+   public:
+    UniformRing(VkDeviceSize frameSize, uint32_t frameCount);
+
+    void destroy();
+
+    // Must be called once the frame's fence is signaled, before any allocation
+    void beginFrame(uint32_t frameIndex);
+
+    [[nodiscard]]
+    UniformAllocation allocate(VkDeviceSize size);
+
+    template <typename T>
+    uint32_t push(const T& data) {
+        const UniformAllocation allocation = allocate(sizeof(T));
+        memcpy(allocation.data, &data, sizeof(T));
+
+        return allocation.offset;
+    }
+
+    // Flushes everything written this frame, only does work on non coherent memory
+    void flush() const;
+
+    [[nodiscard]]
+    const Buffer& getBuffer() const;
+
+    // `range` is the size seen by the shader for each dynamic offset
+    [[nodiscard]]
+    VkDescriptorBufferInfo getDescriptorInfo(VkDeviceSize range) const;
+
+   private:
+    [[nodiscard]]
+    VkDeviceSize m_align(VkDeviceSize size) const;
+
+    GpuHandle<Buffer> m_buffer;
+    uint8_t* m_mapped = nullptr;
+
+    VkDeviceSize m_alignment = 0;
+    VkDeviceSize m_frameSize = 0;
+    uint32_t m_frameCount = 0;
+
+    VkDeviceSize m_frameBegin = 0;
+    VkDeviceSize m_head = 0;
+};
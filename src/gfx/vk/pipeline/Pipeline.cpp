@@ -2,6 +2,9 @@
 
 #include <fmt/format.h>
 
+#include <array>
+
+#include "PipelineCache.h"
 #include "gfx/vk/types/VulkanContext.h"
 #include "gfx/vk/vkutil.h"
 
@@ -13,28 +16,76 @@ Pipeline::Pipeline(const Type type, const char* vertexShaderPath, const char* fr
                    const VkPipelineMultisampleStateCreateInfo& multisample,
                    const VkPipelineColorBlendStateCreateInfo& colorBlendState,
                    const VkPipelineDepthStencilStateCreateInfo& depthStencilState, const VkPipelineLayout& layout,
-                   const VkRenderPass& renderPass)
-    : m_vertexShader(vertexShaderPath, Shader::Type::Vertex),
-      m_fragmentShader(fragmentShaderPath, Shader::Type::Fragment) {
+                   const RenderTarget& target, const VkSpecializationInfo* fragmentSpecialization)
+    : m_bindPoint(VK_PIPELINE_BIND_POINT_GRAPHICS) {
+    m_shaders.reserve(2);  // References below must survive the second emplace
+    try {
+        m_shaders.emplace_back(vertexShaderPath, Shader::Type::Vertex);
+        m_shaders.emplace_back(fragmentShaderPath, Shader::Type::Fragment);
+    } catch (...) {
+        destroy();  // Compile errors are expected while hot reloading, the vertex module mustn't leak
+        throw;
+    }
+
+    const Shader& vertexShader = m_shaders[0];
+    const Shader& fragmentShader = m_shaders[1];
+
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = m_vertexShader.getModule();
-    vertShaderStageInfo.pName = m_vertexShader.getEntryPoint();
+    vertShaderStageInfo.module = vertexShader.getModule();
+    vertShaderStageInfo.pName = vertexShader.getEntryPoint();
 
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = m_fragmentShader.getModule();
-    fragShaderStageInfo.pName = m_fragmentShader.getEntryPoint();
+    fragShaderStageInfo.module = fragmentShader.getModule();
+    fragShaderStageInfo.pName = fragmentShader.getEntryPoint();
+    fragShaderStageInfo.pSpecializationInfo = fragmentSpecialization;
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {
         vertShaderStageInfo,
         fragShaderStageInfo,
     };
 
+    // Viewport and scissor are set at record time, so that pipelines survive swap chain resizes
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    // Pipelines differing only by cull or depth state collapse into one
+    m_hasDynamicState = VulkanContext::get().hasExtendedDynamicState();
+    if (m_hasDynamicState) {
+        constexpr std::array extendedDynamicStates = {
+            VK_DYNAMIC_STATE_CULL_MODE_EXT,
+            VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+            VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+            VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+            VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT,
+        };
+        dynamicStates.insert(dynamicStates.end(), extendedDynamicStates.begin(), extendedDynamicStates.end());
+
+        m_dynamicState = {
+            .cullMode = rasterizer.cullMode,
+            .frontFace = rasterizer.frontFace,
+            .depthTestEnable = depthStencilState.depthTestEnable,
+            .depthWriteEnable = depthStencilState.depthWriteEnable,
+            .depthCompareOp = depthStencilState.depthCompareOp,
+        };
+    }
+
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
+    dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateInfo.dynamicStateCount = dynamicStates.size();
+    dynamicStateInfo.pDynamicStates = dynamicStates.data();
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &target.colorFormat;
+    renderingInfo.depthAttachmentFormat = target.depthFormat;
+
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = static_cast<VkStructureType>(type);
+    pipelineInfo.pNext = target.renderPass == VK_NULL_HANDLE ? &renderingInfo : nullptr;
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputState;
@@ -45,16 +96,41 @@ Pipeline::Pipeline(const Type type, const char* vertexShaderPath, const char* fr
     pipelineInfo.pDepthStencilState = nullptr;
     pipelineInfo.pColorBlendState = &colorBlendState;
     pipelineInfo.pDepthStencilState = &depthStencilState;
-    // TODO: Later maybe
-    // pipelineInfo.pDynamicState = &dynamicStateInfo;
+    pipelineInfo.pDynamicState = &dynamicStateInfo;
     pipelineInfo.layout = layout;
-    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.renderPass = target.renderPass;
     pipelineInfo.subpass = 0;
 
-    // TODO: Use pipeline cache?
-    VK_CHECK("failed to create graphics pipeline!",
-             vkCreateGraphicsPipelines(VulkanContext::get().getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                       &m_underlying));
+    const VkResult result = vkCreateGraphicsPipelines(VulkanContext::get().getDevice(),
+                                                      PipelineCache::get().getUnderlying(), 1, &pipelineInfo, nullptr,
+                                                      &m_underlying);
+    if (result != VK_SUCCESS) {
+        destroy();
+    }
+
+    VK_CHECK("failed to create graphics pipeline!", result);
+}
+
+Pipeline::Pipeline(const char* computeShaderPath, const VkPipelineLayout& layout)
+    : m_bindPoint(VK_PIPELINE_BIND_POINT_COMPUTE) {
+    const Shader& computeShader = m_shaders.emplace_back(computeShaderPath, Shader::Type::Compute);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = static_cast<VkStructureType>(Type::Compute);
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = computeShader.getModule();
+    pipelineInfo.stage.pName = computeShader.getEntryPoint();
+    pipelineInfo.layout = layout;
+
+    const VkResult result = vkCreateComputePipelines(VulkanContext::get().getDevice(),
+                                                     PipelineCache::get().getUnderlying(), 1, &pipelineInfo, nullptr,
+                                                     &m_underlying);
+    if (result != VK_SUCCESS) {
+        destroy();
+    }
+
+    VK_CHECK("failed to create compute pipeline!", result);
 }
 
 const VkPipeline& Pipeline::getUnderlying() const {
@@ -62,11 +138,23 @@ const VkPipeline& Pipeline::getUnderlying() const {
 }
 
 void Pipeline::bind(const VkCommandBuffer& commandBuffer) const {
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_underlying);
+    vkCmdBindPipeline(commandBuffer, m_bindPoint, m_underlying);
+    if (!m_hasDynamicState) {
+        return;
+    }
+
+    const VulkanContext::ExtensionFunctions& functions = VulkanContext::get().getExtensionFunctions();
+    functions.cmdSetCullMode(commandBuffer, m_dynamicState.cullMode);
+    functions.cmdSetFrontFace(commandBuffer, m_dynamicState.frontFace);
+    functions.cmdSetDepthTestEnable(commandBuffer, m_dynamicState.depthTestEnable);
+    functions.cmdSetDepthWriteEnable(commandBuffer, m_dynamicState.depthWriteEnable);
+    functions.cmdSetDepthCompareOp(commandBuffer, m_dynamicState.depthCompareOp);
 }
 
 void Pipeline::destroy() const {
-    m_vertexShader.destroy();
-    m_fragmentShader.destroy();
+    for (const Shader& shader : m_shaders) {
+        shader.destroy();
+    }
+
     vkDestroyPipeline(VulkanContext::get().getDevice(), m_underlying, nullptr);
 }
\ No newline at end of file
@@ -2,14 +2,27 @@
 
 #include <vulkan/vulkan.h>
 
+#include <vector>
+
 #include "gfx/vk/gpu_resources/Shader.h"
 
 class Pipeline {
    public:
     enum Type {
         Graphics = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        Compute = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+    };
+
+    // What a graphics pipeline renders into. Without a render pass, the pipeline targets a dynamic rendering
+    // pass (VK_KHR_dynamic_rendering) and only needs the attachment formats.
+    struct RenderTarget {
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
     };
 
+    // fragmentSpecialization selects a permutation of the fragment shader, see SceneSpecialization.
+    // With VK_EXT_extended_dynamic_state, cull and depth state become dynamic and are set by bind().
     explicit Pipeline(Type type, const char* vertexShaderPath, const char* fragmentShaderPath,
                       const VkPipelineVertexInputStateCreateInfo& vertexInputState,
                       const VkPipelineInputAssemblyStateCreateInfo& inputAssembly,
@@ -18,7 +31,10 @@ class Pipeline {
                       const VkPipelineMultisampleStateCreateInfo& multisample,
                       const VkPipelineColorBlendStateCreateInfo& colorBlendState,
                       const VkPipelineDepthStencilStateCreateInfo& depthStencilState, const VkPipelineLayout& layout,
-                      const VkRenderPass& renderPass);
+                      const RenderTarget& target, const VkSpecializationInfo* fragmentSpecialization = nullptr);
+
+    // Compute pipeline
+    explicit Pipeline(const char* computeShaderPath, const VkPipelineLayout& layout);
 
     [[nodiscard]]
     const VkPipeline& getUnderlying() const;
@@ -28,8 +44,20 @@ class Pipeline {
     void destroy() const;
 
    private:
+    // Values of the extended dynamic state, replayed by bind()
+    struct DynamicState {
+        VkCullModeFlags cullMode;
+        VkFrontFace frontFace;
+        VkBool32 depthTestEnable;
+        VkBool32 depthWriteEnable;
+        VkCompareOp depthCompareOp;
+    };
+
     VkPipeline m_underlying = VK_NULL_HANDLE;
+    VkPipelineBindPoint m_bindPoint;
+
+    bool m_hasDynamicState = false;
+    DynamicState m_dynamicState{};
 
-    Shader m_vertexShader;
-    Shader m_fragmentShader;
+    std::vector<Shader> m_shaders;
 };
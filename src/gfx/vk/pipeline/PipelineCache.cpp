@@ -0,0 +1,137 @@
+#include "PipelineCache.h"
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "gfx/vk/types/VulkanContext.h"
+#include "gfx/vk/vkutil.h"
+
+constexpr uint32_t cacheFileMagic = 0x4843504B;  // "KPCH"
+constexpr uint32_t cacheFileVersion = 1;
+
+namespace {
+uint64_t hashData(const std::vector<char>& data) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const char byte : data) {
+        hash ^= static_cast<uint8_t>(byte);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+// Empty when the file is missing or was written by another device / driver
+std::vector<char> readCacheFile(const std::string& path, const void* expectedHeader, const size_t headerSize) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return {};
+    }
+
+    std::vector<char> header(headerSize);
+    if (!file.read(header.data(), headerSize) || std::memcmp(header.data(), expectedHeader, headerSize) != 0) {
+        fmt::println("Pipeline cache {} doesn't match this device or driver, ignored", path);
+        return {};
+    }
+
+    return { std::istreambuf_iterator(file), std::istreambuf_iterator<char>() };
+}
+}  // namespace
+
+PipelineCache& PipelineCache::get() {
+    static PipelineCache shared;
+    return shared;
+}
+
+void PipelineCache::init(const std::string& path) {
+    m_path = path;
+
+    // Everything but the blob's size and hash must match
+    FileHeader expected = m_makeHeader();
+    constexpr size_t identitySize = offsetof(FileHeader, dataSize);
+
+    std::vector<char> data = readCacheFile(m_path, &expected, identitySize);
+    if (!data.empty()) {
+        FileHeader stored{};
+        std::memcpy(&stored.dataSize, data.data(), sizeof(FileHeader) - identitySize);
+        data.erase(data.begin(), data.begin() + (sizeof(FileHeader) - identitySize));
+
+        if (stored.dataSize != data.size() || stored.dataHash != hashData(data)) {
+            fmt::println("Pipeline cache {} is corrupted, ignored", m_path);
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VK_CHECK("failed to create pipeline cache",
+             vkCreatePipelineCache(VulkanContext::get().getDevice(), &cacheInfo, nullptr, &m_cache));
+
+    fmt::println("Pipeline cache: {}", data.empty() ? "empty" : fmt::format("{} bytes loaded", data.size()));
+}
+
+void PipelineCache::destroy() {
+    save();
+
+    vkDestroyPipelineCache(VulkanContext::get().getDevice(), m_cache, nullptr);
+    m_cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save() const {
+    const VkDevice& device = VulkanContext::get().getDevice();
+
+    size_t dataSize = 0;
+    VK_CHECK("failed to get pipeline cache size", vkGetPipelineCacheData(device, m_cache, &dataSize, nullptr));
+
+    std::vector<char> data(dataSize);
+    VK_CHECK("failed to get pipeline cache data", vkGetPipelineCacheData(device, m_cache, &dataSize, data.data()));
+    data.resize(dataSize);
+
+    FileHeader header = m_makeHeader();
+    header.dataSize = data.size();
+    header.dataHash = hashData(data);
+
+    // Written aside then renamed, an interrupted save never leaves a half written cache behind
+    const std::string tmpPath = m_path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            fmt::println("Unable to write pipeline cache {}", tmpPath);
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, m_path, error);
+    if (error) {
+        fmt::println("Unable to write pipeline cache {}: {}", m_path, error.message());
+    }
+}
+
+VkPipelineCache PipelineCache::getUnderlying() const {
+    return m_cache;
+}
+
+PipelineCache::FileHeader PipelineCache::m_makeHeader() const {
+    const VkPhysicalDeviceProperties& properties = VulkanContext::get().getPhysicalDevice().getProperties();
+
+    FileHeader header{};
+    header.magic = cacheFileMagic;
+    header.version = cacheFileVersion;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    return header;
+}
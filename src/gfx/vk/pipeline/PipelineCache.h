@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <string>
+
+// VkPipelineCache shared by every Pipeline, persisted to disk between runs.
+// The file is prefixed with the identity of the device and driver that produced it,
+// a cache from another GPU or driver version is discarded rather than handed to the driver.
+class PipelineCache {
+   public:
+    static PipelineCache& get();
+
+    // Loads `path` when it exists and matches the current device, starts empty otherwise
+    void init(const std::string& path);
+
+    // Writes the cache back then destroys it
+    void destroy();
+
+    // Safe to call at any time, e.g. after a batch of pipelines was created
+    void save() const;
+
+    [[nodiscard]]
+    VkPipelineCache getUnderlying() const;
+
+   private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t reserved;  // Explicit padding, the identity part is compared bytewise
+        uint64_t dataSize;
+        uint64_t dataHash;  // FNV-1a of the driver blob, catches truncated writes
+    };
+
+    PipelineCache() = default;
+
+    [[nodiscard]]
+    FileHeader m_makeHeader() const;
+
+    std::string m_path;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+};
@@ -0,0 +1,146 @@
+#include "PipelineManager.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+PipelineManager& PipelineManager::get() {
+    static PipelineManager shared;
+    return shared;
+}
+
+void PipelineManager::init(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+    }
+
+    m_stopping = false;
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&PipelineManager::m_workerLoop, this);
+    }
+}
+
+void PipelineManager::destroy() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+        m_jobs.clear();
+    }
+
+    m_jobReady.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+
+    // Unpublished results and variants are retired through their GpuHandle
+    m_results.clear();
+    m_variants.clear();
+    m_pendingCount = 0;
+}
+
+void PipelineManager::request(const Key key, const std::vector<std::string>& shaderPaths, Factory factory) {
+    const auto [it, isNew] = m_variants.try_emplace(key);
+    if (!isNew) {
+        return;
+    }
+
+    it->second.shaderPaths = shaderPaths;
+    it->second.factory = factory;
+    ++m_pendingCount;
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push_back({ .key = key, .factory = std::move(factory) });
+    }
+    m_jobReady.notify_one();
+}
+
+uint32_t PipelineManager::update() {
+    std::vector<Result> results;
+    {
+        std::lock_guard lock(m_mutex);
+        results.swap(m_results);
+    }
+
+    for (Result& result : results) {
+        Variant& variant = m_variants.at(result.key);
+        --m_pendingCount;
+
+        if (!result.pipeline) {
+            variant.state = State::Failed;
+            continue;
+        }
+
+        variant.state = State::Ready;
+        variant.pipeline = std::move(result.pipeline);
+        PipelineReloader::get().watch(variant.pipeline, variant.shaderPaths, variant.factory);
+    }
+
+    return results.size();
+}
+
+void PipelineManager::wait(const Key key) {
+    if (!m_variants.contains(key)) {
+        throw std::runtime_error(fmt::format("Pipeline {:016x} was never requested", key));
+    }
+
+    while (m_variants.at(key).state == State::Pending) {
+        {
+            std::unique_lock lock(m_mutex);
+            m_resultReady.wait(lock, [this] { return !m_results.empty(); });
+        }
+
+        update();
+    }
+}
+
+PipelineManager::State PipelineManager::getState(const Key key) const {
+    const auto it = m_variants.find(key);
+    return it == m_variants.end() ? State::Unknown : it->second.state;
+}
+
+const Pipeline* PipelineManager::find(const Key key) const {
+    const auto it = m_variants.find(key);
+    return it == m_variants.end() ? nullptr : it->second.pipeline.get();
+}
+
+const Pipeline* PipelineManager::findOrFallback(const Key key, const Key fallback) const {
+    const Pipeline* pipeline = find(key);
+    return pipeline != nullptr ? pipeline : find(fallback);
+}
+
+uint32_t PipelineManager::getPendingCount() const {
+    return m_pendingCount;
+}
+
+void PipelineManager::m_workerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_jobReady.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping) {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        Result result{ .key = job.key, .pipeline = {} };
+        try {
+            result.pipeline = GpuHandle<Pipeline>(job.factory());
+        } catch (const std::exception& error) {
+            fmt::println("Failed to build pipeline {:016x}: {}", job.key, error.what());
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_results.push_back(std::move(result));
+        }
+        m_resultReady.notify_all();
+    }
+}
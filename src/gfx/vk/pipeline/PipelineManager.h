@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Pipeline.h"
+#include "PipelineReloader.h"
+#include "gfx/vk/GpuHandle.h"
+
+// Builds pipeline variants on worker threads so that new content never stalls a frame. Lookups never wait:
+// until a variant is ready, draws use a generic variant instead or are skipped. Ready variants are handed
+// to the PipelineReloader.
+class PipelineManager {
+   public:
+    typedef uint64_t Key;
+    using Factory = PipelineReloader::Factory;
+
+    enum class State {
+        Unknown,  // Never requested
+        Pending,
+        Ready,
+        Failed,
+    };
+
+    static PipelineManager& get();
+
+    // 0 picks half the hardware concurrency, leaving room for the render thread
+    void init(uint32_t threadCount = 0);
+
+    // Waits for the builds in progress and retires every variant. The PipelineReloader must be stopped.
+    void destroy();
+
+    // Queues a build, no-op when `key` was already requested. `shaderPaths` are only used for hot reload.
+    void request(Key key, const std::vector<std::string>& shaderPaths, Factory factory);
+
+    // Main thread, between frames: makes the variants built since the last call visible to find()
+    uint32_t update();
+
+    // Blocks until `key` is built, for startup or loading screens only
+    void wait(Key key);
+
+    [[nodiscard]]
+    State getState(Key key) const;
+
+    // nullptr unless ready
+    [[nodiscard]]
+    const Pipeline* find(Key key) const;
+
+    // `key` when ready, `fallback` otherwise, nullptr (skip the draw) when neither is
+    [[nodiscard]]
+    const Pipeline* findOrFallback(Key key, Key fallback) const;
+
+    [[nodiscard]]
+    uint32_t getPendingCount() const;
+
+   private:
+    struct Variant {
+        State state = State::Pending;
+        GpuHandle<Pipeline> pipeline;  // Stable address, watched by the PipelineReloader
+        std::vector<std::string> shaderPaths;
+        Factory factory;
+    };
+
+    struct Job {
+        Key key;
+        Factory factory;
+    };
+
+    struct Result {
+        Key key;
+        GpuHandle<Pipeline> pipeline;  // Empty when the build failed
+    };
+
+    PipelineManager() = default;
+
+    void m_workerLoop();
+
+    // Main thread only
+    std::unordered_map<Key, Variant> m_variants;
+    uint32_t m_pendingCount = 0;
+
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_resultReady;
+    std::deque<Job> m_jobs;
+    std::vector<Result> m_results;
+    bool m_stopping = false;
+};
@@ -0,0 +1,153 @@
+#include "PipelineReloader.h"
+
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "gfx/vk/gpu_resources/ShaderCache.h"
+
+namespace {
+bool isShaderStage(const std::filesystem::path& path) {
+    const std::filesystem::path extension = path.extension();
+    return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
+}  // namespace
+
+PipelineReloader& PipelineReloader::get() {
+    static PipelineReloader shared;
+    return shared;
+}
+
+void PipelineReloader::start(const std::string& shaderDirectory) {
+    // Hot reload is a development convenience, the app runs without it
+    try {
+        m_watcher = std::make_unique<FileWatcher>(shaderDirectory);
+    } catch (const std::runtime_error& error) {
+        fmt::println("Shader hot reload disabled: {}", error.what());
+        return;
+    }
+
+    m_stopping = false;
+    m_thread = std::thread(&PipelineReloader::m_threadLoop, this);
+    fmt::println("Watching {} for shader changes", shaderDirectory);
+}
+
+void PipelineReloader::stop() {
+    m_stopping = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    m_watcher.reset();
+
+    std::lock_guard lock(m_mutex);
+    m_entries.clear();
+    m_ready.clear();
+}
+
+void PipelineReloader::watch(GpuHandle<Pipeline>& target, const std::vector<std::string>& shaderPaths,
+                             Factory factory) {
+    Entry entry{ .target = &target, .shaderPaths = {}, .factory = std::move(factory) };
+    for (const std::string& path : shaderPaths) {
+        entry.shaderPaths.push_back(std::filesystem::path(path).lexically_normal().string());
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_entries.push_back(std::move(entry));
+}
+
+uint32_t PipelineReloader::apply() {
+    std::vector<Replacement> ready;
+    {
+        std::lock_guard lock(m_mutex);
+        ready.swap(m_ready);
+    }
+
+    for (Replacement& replacement : ready) {
+        *replacement.target = std::move(replacement.pipeline);
+    }
+
+    if (!ready.empty()) {
+        fmt::println("Swapped in {} reloaded pipeline(s)", ready.size());
+    }
+
+    return ready.size();
+}
+
+void PipelineReloader::m_threadLoop() {
+    while (!m_stopping) {
+        std::vector<std::string> changedPaths = m_watcher->wait(pollInterval);
+        if (changedPaths.empty()) {
+            continue;
+        }
+
+        for (std::vector<std::string> more; !m_stopping && !(more = m_watcher->wait(debounceDelay)).empty();) {
+            changedPaths.insert(changedPaths.end(), more.begin(), more.end());
+        }
+
+        std::ranges::sort(changedPaths);
+        const auto duplicates = std::ranges::unique(changedPaths);
+        changedPaths.erase(duplicates.begin(), duplicates.end());
+
+        m_rebuild(changedPaths);
+    }
+}
+
+void PipelineReloader::m_rebuild(const std::vector<std::string>& changedPaths) {
+    // Memory hits don't look at the files anymore
+    ShaderCache::get().invalidate(changedPaths);
+
+    // Includes aren't tracked per pipeline: a changed .glsl rebuilds everything, the ShaderCache
+    // still hits for the shaders that don't actually include it
+    bool rebuildAll = false;
+    std::vector<std::string> changedStages;
+    for (const std::string& path : changedPaths) {
+        if (isShaderStage(path)) {
+            changedStages.push_back(path);
+        } else if (std::filesystem::path(path).extension() == ".glsl") {
+            rebuildAll = true;
+        }
+    }
+
+    std::vector<Entry> affected;
+    {
+        std::lock_guard lock(m_mutex);
+        for (const Entry& entry : m_entries) {
+            const bool isAffected = rebuildAll || std::ranges::any_of(entry.shaderPaths, [&](const std::string& path) {
+                                        return std::ranges::find(changedStages, path) != changedStages.end();
+                                    });
+            if (isAffected) {
+                affected.push_back(entry);
+            }
+        }
+    }
+
+    for (const Entry& entry : affected) {
+        if (m_stopping) {
+            return;
+        }
+
+        const std::string name = fmt::format("{}", fmt::join(entry.shaderPaths, " + "));
+
+        GpuHandle<Pipeline> pipeline;
+        try {
+            pipeline = GpuHandle<Pipeline>(entry.factory());
+        } catch (const std::exception& error) {
+            fmt::println("Reload of {} failed, keeping the current pipeline:\n{}", name, error.what());
+            continue;
+        }
+
+        fmt::println("Rebuilt {}", name);
+
+        std::lock_guard lock(m_mutex);
+        // A replacement not applied yet is superseded, assigning over it retires it
+        const auto it = std::ranges::find(m_ready, entry.target, &Replacement::target);
+        if (it != m_ready.end()) {
+            it->pipeline = std::move(pipeline);
+        } else {
+            m_ready.push_back({ .target = entry.target, .pipeline = std::move(pipeline) });
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Pipeline.h"
+#include "common/FileWatcher.h"
+#include "gfx/vk/GpuHandle.h"
+
+// Shader hot reload: a background thread watches the shader directory, recompiles what changed and builds the
+// replacement pipelines. apply() swaps them in between frames, the replaced ones are retired through their
+// GpuHandle so in-flight frames keep using them. A failed rebuild is logged and the current pipeline kept.
+class PipelineReloader {
+   public:
+    // Runs on the reload thread, must only touch state that doesn't change after creation (layouts, render pass)
+    using Factory = std::function<std::unique_ptr<Pipeline>()>;
+
+    static PipelineReloader& get();
+
+    void start(const std::string& shaderDirectory);
+
+    // Joins the reload thread, drops the watched pipelines and the replacements not applied yet
+    void stop();
+
+    // `target` is rebuilt with `factory` when one of `shaderPaths` changes, or any included .glsl file.
+    // It must stay alive until stop().
+    void watch(GpuHandle<Pipeline>& target, const std::vector<std::string>& shaderPaths, Factory factory);
+
+    // Main thread, between frames. Never waits on a rebuild, returns the number of pipelines swapped.
+    uint32_t apply();
+
+   private:
+    struct Entry {
+        GpuHandle<Pipeline>* target;
+        std::vector<std::string> shaderPaths;  // Lexically normal, as reported by FileWatcher
+        Factory factory;
+    };
+
+    struct Replacement {
+        GpuHandle<Pipeline>* target;
+        GpuHandle<Pipeline> pipeline;
+    };
+
+    // Bursts of events (editors saving several times, checkouts...) are merged into one rebuild
+    static constexpr auto debounceDelay = std::chrono::milliseconds(50);
+    static constexpr auto pollInterval = std::chrono::milliseconds(250);
+
+    PipelineReloader() = default;
+
+    void m_threadLoop();
+    void m_rebuild(const std::vector<std::string>& changedPaths);
+
+    std::unique_ptr<FileWatcher> m_watcher;
+    std::thread m_thread;
+    std::atomic<bool> m_stopping = false;
+
+    std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    std::vector<Replacement> m_ready;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+// Per-object data read by the culling compute shader and the indirect vertex shader (std430).
+// Keep in sync with shaders/cull.comp and shaders/indirect.vert.
+struct alignas(16) ObjectData {
+    glm::mat4 modelMatrix;
+    glm::mat4 normalMatrix;
+    glm::vec4 boundingSphere;  // Object space
+
+    int32_t vertexOffset;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+
+    uint32_t materialIndex;  // Index of the draw count, one per material
+    uint32_t drawOffset;     // First indirect command slot of the material
+
+    uint32_t __padding[3];
+};
+
+static_assert(sizeof(ObjectData) % 16 == 0);
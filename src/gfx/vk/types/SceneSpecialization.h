@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Material features the scene pipeline is specialized for. The branches of absent features are compiled out
+// of the fragment shader, every combination in use gets its own pipeline (see VK::m_getScenePipeline).
+enum MaterialFeature : uint32_t {
+    BaseColorTexture = 1 << 0,
+    VertexColor = 1 << 1,
+    AlphaMask = 1 << 2,
+};
+
+typedef uint32_t MaterialFeatures;
+
+// The high 16 bits of AlphaMask features hold the material's alpha cutoff, in 1/65535 steps: materials with
+// different cutoffs get different pipelines like any other feature.
+constexpr uint32_t alphaCutoffShift = 16;
+constexpr MaterialFeatures alphaCutoffMask = 0xffffu << alphaCutoffShift;
+
+[[nodiscard]]
+inline MaterialFeatures withAlphaCutoff(const MaterialFeatures features, const float alphaCutoff) {
+    const auto quantized = static_cast<uint32_t>(std::lround(std::clamp(alphaCutoff, 0.0f, 1.0f) * 65535.0f));
+    return (features & ~alphaCutoffMask) | quantized << alphaCutoffShift;
+}
+
+[[nodiscard]]
+inline float getAlphaCutoff(const MaterialFeatures features) {
+    return static_cast<float>((features & alphaCutoffMask) >> alphaCutoffShift) / 65535.0f;
+}
+
+// Specialization constants of shaders/tri.frag, constant_id is the member index. Keep in sync.
+struct SceneSpecialization {
+    VkBool32 hasBaseColorTexture = VK_TRUE;
+    VkBool32 hasVertexColor = VK_FALSE;
+    VkBool32 hasAlphaMask = VK_FALSE;
+    float alphaCutoff = 0.5f;
+
+    // Lighting, constant for every material
+    float ambientStrength = 0.1f;
+    float lightPositionX = -5.0f;
+    float lightPositionY = 0.0f;
+    float lightPositionZ = 5.0f;
+
+    [[nodiscard]]
+    static SceneSpecialization fromFeatures(const MaterialFeatures features) {
+        SceneSpecialization specialization;
+        specialization.hasBaseColorTexture = (features & MaterialFeature::BaseColorTexture) ? VK_TRUE : VK_FALSE;
+        specialization.hasVertexColor = (features & MaterialFeature::VertexColor) ? VK_TRUE : VK_FALSE;
+        specialization.hasAlphaMask = (features & MaterialFeature::AlphaMask) ? VK_TRUE : VK_FALSE;
+        if (specialization.hasAlphaMask) {
+            specialization.alphaCutoff = getAlphaCutoff(features);
+        }
+
+        return specialization;
+    }
+
+    // Points to this struct, which must outlive pipeline creation
+    [[nodiscard]]
+    VkSpecializationInfo getInfo() const {
+        static constexpr std::array<VkSpecializationMapEntry, 8> mapEntries{ {
+            { 0, offsetof(SceneSpecialization, hasBaseColorTexture), sizeof(VkBool32) },
+            { 1, offsetof(SceneSpecialization, hasVertexColor), sizeof(VkBool32) },
+            { 2, offsetof(SceneSpecialization, hasAlphaMask), sizeof(VkBool32) },
+            { 3, offsetof(SceneSpecialization, alphaCutoff), sizeof(float) },
+            { 4, offsetof(SceneSpecialization, ambientStrength), sizeof(float) },
+            { 5, offsetof(SceneSpecialization, lightPositionX), sizeof(float) },
+            { 6, offsetof(SceneSpecialization, lightPositionY), sizeof(float) },
+            { 7, offsetof(SceneSpecialization, lightPositionZ), sizeof(float) },
+        } };
+
+        return { mapEntries.size(), mapEntries.data(), sizeof(SceneSpecialization), this };
+    }
+};
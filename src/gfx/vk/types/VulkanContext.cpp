@@ -1,5 +1,6 @@
 #include "VulkanContext.h"
 
+#include <utility>
 #include <vector>
 #include <fmt/base.h>
 
@@ -14,6 +15,7 @@ void VulkanContext::init(const VkInstance& vkInstance, const VkSurfaceKHR& vkSur
     m_vkInstance = vkInstance;
     m_pickPhysicalDevice(vkSurface);
     m_createLogicalDevice();
+    m_loadExtensionFunctions();
     m_createCommandPool();
 
     m_initialized = true;
@@ -26,6 +28,16 @@ void VulkanContext::destroy() {
         return;
     }
 
+    // Uploads no frame waited on, the device is idle
+    for (const VkSemaphore& semaphore : m_pendingAcquires.uploads) {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+    m_pendingAcquires.uploads.clear();
+
+    if (m_transferCommandPool != m_commandPool) {
+        vkDestroyCommandPool(m_device, m_transferCommandPool, nullptr);
+    }
+
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
     vkDestroyDevice(m_device, nullptr);
 
@@ -37,6 +49,10 @@ bool VulkanContext::isInitialized() const {
     return m_initialized;
 }
 
+const VkInstance& VulkanContext::getInstance() const {
+    return m_vkInstance;
+}
+
 const PhysicalDevice& VulkanContext::getPhysicalDevice() const {
     return *m_physicalDevice;
 }
@@ -57,6 +73,81 @@ const VkQueue& VulkanContext::getPresentQueue() const {
     return m_presentQueue;
 }
 
+bool VulkanContext::hasMemoryBudget() const {
+    return m_hasMemoryBudget;
+}
+
+bool VulkanContext::hasDrawIndirectCount() const {
+    return m_hasDrawIndirectCount;
+}
+
+bool VulkanContext::hasDynamicRendering() const {
+    return m_hasDynamicRendering;
+}
+
+bool VulkanContext::hasExtendedDynamicState() const {
+    return m_hasExtendedDynamicState;
+}
+
+const VulkanContext::ExtensionFunctions& VulkanContext::getExtensionFunctions() const {
+    return m_extensionFunctions;
+}
+
+const VkPhysicalDeviceFeatures& VulkanContext::getEnabledFeatures() const {
+    return m_enabledFeatures;
+}
+
+bool VulkanContext::hasDedicatedTransferQueue() const {
+    return m_physicalDevice->getQueueFamilyIndices().hasDedicatedTransfer();
+}
+
+const VkCommandPool& VulkanContext::getTransferCommandPool() const {
+    return m_transferCommandPool;
+}
+
+const VkQueue& VulkanContext::getTransferQueue() const {
+    return m_transferQueue;
+}
+
+void VulkanContext::enqueueAcquire(const VkBufferMemoryBarrier& barrier, const VkPipelineStageFlags dstStage) {
+    std::lock_guard lock(m_pendingAcquiresMutex);
+    m_pendingAcquires.buffers.push_back(barrier);
+    m_pendingAcquires.dstStages |= dstStage;
+}
+
+void VulkanContext::enqueueAcquire(const VkImageMemoryBarrier& barrier, const VkPipelineStageFlags dstStage) {
+    std::lock_guard lock(m_pendingAcquiresMutex);
+    m_pendingAcquires.images.push_back(barrier);
+    m_pendingAcquires.dstStages |= dstStage;
+}
+
+void VulkanContext::recordPendingAcquires(const VkCommandBuffer& commandBuffer) {
+    std::lock_guard lock(m_pendingAcquiresMutex);
+    if (m_pendingAcquires.buffers.empty() && m_pendingAcquires.images.empty()) {
+        return;
+    }
+
+    // The matching releases signal the upload semaphores the frame waits on at uploadWaitStage,
+    // the acquires chain after that wait.
+    vkCmdPipelineBarrier(commandBuffer, uploadWaitStage, m_pendingAcquires.dstStages, 0, 0, nullptr,
+                         m_pendingAcquires.buffers.size(), m_pendingAcquires.buffers.data(),
+                         m_pendingAcquires.images.size(), m_pendingAcquires.images.data());
+
+    m_pendingAcquires.buffers.clear();
+    m_pendingAcquires.images.clear();
+    m_pendingAcquires.dstStages = 0;
+}
+
+void VulkanContext::enqueueUpload(const VkSemaphore semaphore) {
+    std::lock_guard lock(m_pendingAcquiresMutex);
+    m_pendingAcquires.uploads.push_back(semaphore);
+}
+
+std::vector<VkSemaphore> VulkanContext::takeUploadSemaphores() {
+    std::lock_guard lock(m_pendingAcquiresMutex);
+    return std::exchange(m_pendingAcquires.uploads, {});
+}
+
 void VulkanContext::m_pickPhysicalDevice(const VkSurfaceKHR& vkSurface) {
     fmt::println("Picking a suitable device");
 
@@ -87,11 +178,65 @@ void VulkanContext::m_pickPhysicalDevice(const VkSurfaceKHR& vkSurface) {
 
 void VulkanContext::m_createLogicalDevice() {
     const QueueFamilyIndices& indices = m_physicalDevice->getQueueFamilyIndices();
-    const std::vector requiredVKExtensions{
+    std::vector requiredVKExtensions{
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         // "VK_KHR_portability_subset"
     };
 
+    // Optional, only used for memory telemetry
+    m_hasMemoryBudget = m_physicalDevice->supportsExtensions({ VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+    if (m_hasMemoryBudget) {
+        requiredVKExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    // Optional, GPU driven rendering falls back to fixed size indirect draws without it
+    m_hasDrawIndirectCount = m_physicalDevice->supportsExtensions({ VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME });
+    if (m_hasDrawIndirectCount) {
+        requiredVKExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
+    // Optional, both need their feature bit on top of the extension.
+    // VK_KHR_get_physical_device_properties2 is always enabled on the instance.
+    const std::vector<const char*> dynamicRenderingExtensions{
+        VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+        // Dependencies of dynamic rendering on a Vulkan 1.0 device
+        VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+        VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+        VK_KHR_MULTIVIEW_EXTENSION_NAME,
+        VK_KHR_MAINTENANCE_2_EXTENSION_NAME,
+    };
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    extendedDynamicStateFeatures.pNext = &dynamicRenderingFeatures;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &extendedDynamicStateFeatures;
+
+    const auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+        vkGetInstanceProcAddr(m_vkInstance, "vkGetPhysicalDeviceFeatures2KHR"));
+    if (getFeatures2 != nullptr) {
+        getFeatures2(m_physicalDevice->getUnderlying(), &supportedFeatures);
+    }
+
+    m_hasDynamicRendering =
+        m_physicalDevice->supportsExtensions(dynamicRenderingExtensions) && dynamicRenderingFeatures.dynamicRendering;
+    if (m_hasDynamicRendering) {
+        requiredVKExtensions.insert(requiredVKExtensions.end(), dynamicRenderingExtensions.begin(),
+                                    dynamicRenderingExtensions.end());
+    }
+
+    m_hasExtendedDynamicState =
+        m_physicalDevice->supportsExtensions({ VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME }) &&
+        extendedDynamicStateFeatures.extendedDynamicState;
+    if (m_hasExtendedDynamicState) {
+        requiredVKExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    }
+
     // Queues
     const float queuePriority = 1.0f;
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
@@ -109,9 +254,27 @@ void VulkanContext::m_createLogicalDevice() {
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.imageCubeArray = VK_TRUE;
 
+    // Needed by GPU driven rendering, which is disabled without them
+    deviceFeatures.multiDrawIndirect = m_physicalDevice->getFeatures().multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = m_physicalDevice->getFeatures().drawIndirectFirstInstance;
+    m_enabledFeatures = deviceFeatures;
+
+    // Only the features of enabled extensions may be chained
+    void* enabledFeaturesChain = nullptr;
+    dynamicRenderingFeatures.pNext = nullptr;
+    if (m_hasDynamicRendering) {
+        enabledFeaturesChain = &dynamicRenderingFeatures;
+    }
+
+    extendedDynamicStateFeatures.pNext = enabledFeaturesChain;
+    if (m_hasExtendedDynamicState) {
+        enabledFeaturesChain = &extendedDynamicStateFeatures;
+    }
+
     // Device creation
     VkDeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.pNext = enabledFeaturesChain;
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
     deviceCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
@@ -124,6 +287,32 @@ void VulkanContext::m_createLogicalDevice() {
     // We now get the newly created queues
     vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
+
+    if (indices.hasDedicatedTransfer()) {
+        vkGetDeviceQueue(m_device, indices.transferFamily.value(), 0, &m_transferQueue);
+        fmt::println("Using dedicated transfer queue (family {})", indices.transferFamily.value());
+    } else {
+        m_transferQueue = m_graphicsQueue;
+    }
+}
+
+void VulkanContext::m_loadExtensionFunctions() {
+    const auto load = [this]<typename T>(T& function, const char* name) {
+        function = reinterpret_cast<T>(vkGetDeviceProcAddr(m_device, name));
+    };
+
+    if (m_hasDynamicRendering) {
+        load(m_extensionFunctions.cmdBeginRendering, "vkCmdBeginRenderingKHR");
+        load(m_extensionFunctions.cmdEndRendering, "vkCmdEndRenderingKHR");
+    }
+
+    if (m_hasExtendedDynamicState) {
+        load(m_extensionFunctions.cmdSetCullMode, "vkCmdSetCullModeEXT");
+        load(m_extensionFunctions.cmdSetFrontFace, "vkCmdSetFrontFaceEXT");
+        load(m_extensionFunctions.cmdSetDepthTestEnable, "vkCmdSetDepthTestEnableEXT");
+        load(m_extensionFunctions.cmdSetDepthWriteEnable, "vkCmdSetDepthWriteEnableEXT");
+        load(m_extensionFunctions.cmdSetDepthCompareOp, "vkCmdSetDepthCompareOpEXT");
+    }
 }
 
 void VulkanContext::m_createCommandPool() {
@@ -136,4 +325,15 @@ void VulkanContext::m_createCommandPool() {
 
     VK_CHECK("failed to create command pool!",
              vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    if (!indices.hasDedicatedTransfer()) {
+        m_transferCommandPool = m_commandPool;
+        return;
+    }
+
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = indices.transferFamily.value();
+
+    VK_CHECK("failed to create transfer command pool!",
+             vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_transferCommandPool));
 }
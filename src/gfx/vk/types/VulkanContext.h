@@ -1,11 +1,25 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "../gpu_resources/PhysicalDevice.h"
 
 class VulkanContext {
 public:
+    // Entry points of the optional extensions, null when the extension isn't enabled
+    struct ExtensionFunctions {
+        PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+        PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+        PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+        PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace = nullptr;
+        PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable = nullptr;
+        PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+        PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp = nullptr;
+    };
+
     static VulkanContext& get();
 
     void init(const VkInstance& vkInstance, const VkSurfaceKHR& vkSurface);
@@ -13,6 +27,8 @@ public:
 
     bool isInitialized() const;
 
+    const VkInstance& getInstance() const;
+
     const PhysicalDevice& getPhysicalDevice() const;
     const VkDevice& getDevice() const;
 
@@ -20,12 +36,64 @@ public:
     const VkQueue& getGraphicsQueue() const;
     const VkQueue& getPresentQueue() const;
 
+    // VK_EXT_memory_budget is enabled when the device supports it
+    bool hasMemoryBudget() const;
+
+    // VK_KHR_draw_indirect_count is enabled when the device supports it
+    bool hasDrawIndirectCount() const;
+
+    // VK_KHR_dynamic_rendering (and its dependencies) is enabled when the device supports it
+    bool hasDynamicRendering() const;
+
+    // VK_EXT_extended_dynamic_state is enabled when the device supports it
+    bool hasExtendedDynamicState() const;
+
+    const ExtensionFunctions& getExtensionFunctions() const;
+
+    const VkPhysicalDeviceFeatures& getEnabledFeatures() const;
+
+    // Falls back to the graphics queue/pool when the device has no transfer-only family
+    bool hasDedicatedTransferQueue() const;
+    const VkCommandPool& getTransferCommandPool() const;
+    const VkQueue& getTransferQueue() const;
+
+    // Acquire half of a transfer -> graphics queue family ownership transfer.
+    // The barriers are recorded at the start of the next frame.
+    void enqueueAcquire(const VkBufferMemoryBarrier& barrier, VkPipelineStageFlags dstStage);
+    void enqueueAcquire(const VkImageMemoryBarrier& barrier, VkPipelineStageFlags dstStage);
+    void recordPendingAcquires(const VkCommandBuffer& commandBuffer);
+
+    // Semaphore signaled by an upload submission (see OneTimeCommand), the next frame submission waits on it
+    void enqueueUpload(VkSemaphore semaphore);
+
+    // Uploads submitted since the last call. The caller waits on them at uploadWaitStage, and destroys
+    // them once that submission completes.
+    [[nodiscard]]
+    std::vector<VkSemaphore> takeUploadSemaphores();
+
+    // Uploads are waited on before anything of the frame: acquires are recorded first, with this source stage
+    static constexpr VkPipelineStageFlags uploadWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
 private:
+    struct PendingAcquires {
+        std::vector<VkBufferMemoryBarrier> buffers;
+        std::vector<VkImageMemoryBarrier> images;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<VkSemaphore> uploads;
+    };
+
     void m_pickPhysicalDevice(const VkSurfaceKHR& vkSurface);
     void m_createLogicalDevice();
+    void m_loadExtensionFunctions();
     void m_createCommandPool();
 
     bool m_initialized = false;
+    bool m_hasMemoryBudget = false;
+    bool m_hasDrawIndirectCount = false;
+    bool m_hasDynamicRendering = false;
+    bool m_hasExtendedDynamicState = false;
+    ExtensionFunctions m_extensionFunctions;
+    VkPhysicalDeviceFeatures m_enabledFeatures{};
 
     VkInstance m_vkInstance = VK_NULL_HANDLE;
 
@@ -34,7 +102,12 @@ private:
     VkDevice m_device = VK_NULL_HANDLE;
 
     VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    VkCommandPool m_transferCommandPool = VK_NULL_HANDLE;
 
     VkQueue m_graphicsQueue = VK_NULL_HANDLE;
     VkQueue m_presentQueue = VK_NULL_HANDLE;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+
+    std::mutex m_pendingAcquiresMutex;
+    PendingAcquires m_pendingAcquires;
 };
@@ -0,0 +1,227 @@
+#include "EntityStore.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+Entity EntityStore::create(const Mesh& mesh, const MaterialRef& material, const Transform& transform,
+                           const SceneGraph::NodeID node) {
+    uint32_t slot;
+    if (!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        slot = m_generations.size();
+        m_generations.push_back(0);
+        m_denseIndices.push_back(0);
+    }
+
+    m_denseIndices[slot] = m_slots.size();
+    m_slots.push_back(slot);
+    m_positionX.push_back(transform.position.x);
+    m_positionY.push_back(transform.position.y);
+    m_positionZ.push_back(transform.position.z);
+    m_rotationX.push_back(transform.rotation.x);
+    m_rotationY.push_back(transform.rotation.y);
+    m_rotationZ.push_back(transform.rotation.z);
+    m_rotationW.push_back(transform.rotation.w);
+    m_scaleX.push_back(transform.scale.x);
+    m_scaleY.push_back(transform.scale.y);
+    m_scaleZ.push_back(transform.scale.z);
+    m_nodes.push_back(node);
+    m_dirty.push_back(1);
+    m_worldMatrices.emplace_back(1.0f);
+    m_normalMatrices.emplace_back(1.0f);
+    m_worldBounds.push_back(mesh.getAABB());
+    m_meshes.push_back(&mesh);
+    m_materials.push_back(material);
+    m_visibility.push_back(1);
+    m_changeStamps.push_back(0);
+    ++m_structureVersion;
+
+    return { .index = slot, .generation = m_generations[slot] };
+}
+
+void EntityStore::destroy(const Entity entity) {
+    const uint32_t dense = getDenseIndex(entity);
+    const uint32_t last = m_slots.size() - 1;
+
+    // The last entity takes the freed dense index
+    const auto moveLast = [dense, last](auto& components) {
+        components[dense] = components[last];
+        components.pop_back();
+    };
+
+    m_denseIndices[m_slots[last]] = dense;
+    moveLast(m_slots);
+    for (std::vector<float>* component : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY,
+                                           &m_rotationZ, &m_rotationW, &m_scaleX, &m_scaleY, &m_scaleZ }) {
+        moveLast(*component);
+    }
+    moveLast(m_nodes);
+    moveLast(m_dirty);
+    moveLast(m_worldMatrices);
+    moveLast(m_normalMatrices);
+    moveLast(m_worldBounds);
+    moveLast(m_meshes);
+    moveLast(m_materials);
+    moveLast(m_visibility);
+    moveLast(m_changeStamps);
+    ++m_structureVersion;
+
+    ++m_generations[entity.index];
+    m_freeSlots.push_back(entity.index);
+}
+
+bool EntityStore::isAlive(const Entity entity) const {
+    // Destroying bumps the generation, freed slots never match a handle
+    return entity.index < m_generations.size() && m_generations[entity.index] == entity.generation;
+}
+
+Transform EntityStore::getTransform(const Entity entity) const {
+    const uint32_t dense = getDenseIndex(entity);
+    return {
+        glm::vec3(m_positionX[dense], m_positionY[dense], m_positionZ[dense]),
+        glm::quat(m_rotationW[dense], m_rotationX[dense], m_rotationY[dense], m_rotationZ[dense]),
+        glm::vec3(m_scaleX[dense], m_scaleY[dense], m_scaleZ[dense]),
+    };
+}
+
+void EntityStore::setTransform(const Entity entity, const Transform& transform) {
+    const uint32_t dense = getDenseIndex(entity);
+    m_positionX[dense] = transform.position.x;
+    m_positionY[dense] = transform.position.y;
+    m_positionZ[dense] = transform.position.z;
+    m_rotationX[dense] = transform.rotation.x;
+    m_rotationY[dense] = transform.rotation.y;
+    m_rotationZ[dense] = transform.rotation.z;
+    m_rotationW[dense] = transform.rotation.w;
+    m_scaleX[dense] = transform.scale.x;
+    m_scaleY[dense] = transform.scale.y;
+    m_scaleZ[dense] = transform.scale.z;
+    m_dirty[dense] = 1;
+}
+
+uint32_t EntityStore::getDenseIndex(const Entity entity) const {
+    if (entity.index >= m_generations.size() || m_generations[entity.index] != entity.generation) {
+        throw std::runtime_error(fmt::format("entity store: stale entity {}:{}", entity.index, entity.generation));
+    }
+
+    return m_denseIndices[entity.index];
+}
+
+uint32_t EntityStore::size() const {
+    return m_slots.size();
+}
+
+void EntityStore::updateTransforms(const SceneGraph& graph) {
+    const uint32_t count = m_slots.size();
+    for (uint32_t i = 0; i < count; ++i) {
+        const SceneGraph::NodeID node = m_nodes[i];
+        if (node != SceneGraph::noParent && graph.hasChanged(node)) {
+            m_dirty[i] = 1;
+        }
+    }
+
+    const uint64_t stamp = m_lastChange + 1;
+
+    // Local matrices of each run of dirty entities in one batch, then parented in place
+    uint32_t i = 0;
+    while (i < count) {
+        if (!m_dirty[i]) {
+            ++i;
+            continue;
+        }
+
+        const uint32_t runBegin = i;
+        while (i < count && m_dirty[i]) {
+            ++i;
+        }
+
+        TransformKernels::computeMatrices(m_getTransformArrays(runBegin), i - runBegin, &m_worldMatrices[runBegin],
+                                          &m_normalMatrices[runBegin]);
+
+        // The inverse transpose of a product is the product of the inverse transposes. Entities of a model are
+        // created together, the node's normal matrix is computed once for them.
+        SceneGraph::NodeID normalNode = SceneGraph::noParent;
+        glm::mat4 nodeNormalMatrix(1.0f);
+        for (uint32_t entity = runBegin; entity < i; ++entity) {
+            const SceneGraph::NodeID node = m_nodes[entity];
+            if (node != SceneGraph::noParent) {
+                const glm::mat4& nodeMatrix = graph.getWorldMatrix(node);
+                if (node != normalNode) {
+                    nodeNormalMatrix = Transform::getNormalMatrix(nodeMatrix);
+                    normalNode = node;
+                }
+
+                m_worldMatrices[entity] = nodeMatrix * m_worldMatrices[entity];
+                m_normalMatrices[entity] = nodeNormalMatrix * m_normalMatrices[entity];
+            }
+
+            m_worldBounds[entity] = m_meshes[entity]->getAABB().transform(m_worldMatrices[entity]);
+            m_dirty[entity] = 0;
+            m_changeStamps[entity] = stamp;
+        }
+
+        m_lastChange = stamp;
+    }
+}
+
+uint64_t EntityStore::getStructureVersion() const {
+    return m_structureVersion;
+}
+
+uint64_t EntityStore::getLastChange() const {
+    return m_lastChange;
+}
+
+void EntityStore::setVisible(const std::vector<uint32_t>& visible) {
+    std::ranges::fill(m_visibility, 0);
+    for (const uint32_t dense : visible) {
+        m_visibility[dense] = 1;
+    }
+}
+
+const std::vector<glm::mat4>& EntityStore::getWorldMatrices() const {
+    return m_worldMatrices;
+}
+
+const std::vector<glm::mat4>& EntityStore::getNormalMatrices() const {
+    return m_normalMatrices;
+}
+
+const std::vector<AABB>& EntityStore::getWorldBounds() const {
+    return m_worldBounds;
+}
+
+const std::vector<const Mesh*>& EntityStore::getMeshes() const {
+    return m_meshes;
+}
+
+const std::vector<MaterialRef>& EntityStore::getMaterials() const {
+    return m_materials;
+}
+
+const std::vector<uint8_t>& EntityStore::getVisibility() const {
+    return m_visibility;
+}
+
+const std::vector<uint64_t>& EntityStore::getChangeStamps() const {
+    return m_changeStamps;
+}
+
+TransformKernels::TransformArrays EntityStore::m_getTransformArrays(const uint32_t dense) const {
+    return {
+        .positionX = m_positionX.data() + dense,
+        .positionY = m_positionY.data() + dense,
+        .positionZ = m_positionZ.data() + dense,
+        .rotationX = m_rotationX.data() + dense,
+        .rotationY = m_rotationY.data() + dense,
+        .rotationZ = m_rotationZ.data() + dense,
+        .rotationW = m_rotationW.data() + dense,
+        .scaleX = m_scaleX.data() + dense,
+        .scaleY = m_scaleY.data() + dense,
+        .scaleZ = m_scaleZ.data() + dense,
+    };
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Mesh.h"
+#include "common/Bounds.h"
+#include "common/SceneGraph.h"
+#include "common/Transform.h"
+#include "common/TransformKernels.h"
+#include "gfx/vk/gpu_resources/Texture.h"
+#include "gfx/vk/types/SceneSpecialization.h"
+
+// Generational handle: a destroyed entity's slot is reused with the next generation, stale handles are detected
+struct Entity {
+    static constexpr uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+
+    uint32_t index = invalidIndex;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity& other) const = default;
+};
+
+struct MaterialRef {
+    Texture::ID textureID;
+    MaterialFeatures features;
+};
+
+// Drawable entities, one per mesh. Components live in dense arrays indexed alike, so that systems iterate
+// them linearly; destroying an entity moves the last one into its place.
+class EntityStore {
+   public:
+    // `mesh` must outlive the entity. The transform is relative to `node`, its rotation a unit quaternion.
+    Entity create(const Mesh& mesh, const MaterialRef& material, const Transform& transform,
+                  SceneGraph::NodeID node = SceneGraph::noParent);
+
+    void destroy(Entity entity);
+
+    [[nodiscard]]
+    bool isAlive(Entity entity) const;
+
+    [[nodiscard]]
+    Transform getTransform(Entity entity) const;
+
+    void setTransform(Entity entity, const Transform& transform);
+
+    // Dense index of a live entity, valid until the next destroy
+    [[nodiscard]]
+    uint32_t getDenseIndex(Entity entity) const;
+
+    [[nodiscard]]
+    uint32_t size() const;
+
+    // Recomputes the world matrices and bounds of the entities whose transform or node changed,
+    // runs of them in batches through TransformKernels
+    void updateTransforms(const SceneGraph& graph);
+
+    // Bumped by create() and destroy(): dense indices and the component arrays' layout changed
+    [[nodiscard]]
+    uint64_t getStructureVersion() const;
+
+    // Stamp of the last updateTransforms() that changed a world matrix, 0 before any.
+    // Consumers keeping a copy of the matrices refresh the entities changed after the stamp they last saw.
+    [[nodiscard]]
+    uint64_t getLastChange() const;
+
+    // Sets the visibility of every entity, `visible` holds dense indices
+    void setVisible(const std::vector<uint32_t>& visible);
+
+    // Dense component arrays, indexed alike. Valid until the next create or destroy.
+    [[nodiscard]]
+    const std::vector<glm::mat4>& getWorldMatrices() const;
+
+    [[nodiscard]]
+    const std::vector<glm::mat4>& getNormalMatrices() const;
+
+    [[nodiscard]]
+    const std::vector<AABB>& getWorldBounds() const;
+
+    [[nodiscard]]
+    const std::vector<const Mesh*>& getMeshes() const;
+
+    [[nodiscard]]
+    const std::vector<MaterialRef>& getMaterials() const;
+
+    // uint8_t rather than bool, see SceneGraph
+    [[nodiscard]]
+    const std::vector<uint8_t>& getVisibility() const;
+
+    // getLastChange() when the entity's world matrix was last recomputed
+    [[nodiscard]]
+    const std::vector<uint64_t>& getChangeStamps() const;
+
+   private:
+    // Local transforms from `dense` onwards, as kernel inputs
+    [[nodiscard]]
+    TransformKernels::TransformArrays m_getTransformArrays(uint32_t dense) const;
+
+    // Per slot (Entity::index)
+    std::vector<uint32_t> m_generations;
+    std::vector<uint32_t> m_denseIndices;
+    std::vector<uint32_t> m_freeSlots;
+
+    // Dense
+    std::vector<uint32_t> m_slots;
+    // Local transforms split by component for the batch kernels, as in SceneGraph
+    std::vector<float> m_positionX, m_positionY, m_positionZ;
+    std::vector<float> m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+    std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+    std::vector<SceneGraph::NodeID> m_nodes;
+    std::vector<uint8_t> m_dirty;
+    std::vector<glm::mat4> m_worldMatrices;
+    std::vector<glm::mat4> m_normalMatrices;
+    std::vector<AABB> m_worldBounds;
+    std::vector<const Mesh*> m_meshes;
+    std::vector<MaterialRef> m_materials;
+    std::vector<uint8_t> m_visibility;
+    std::vector<uint64_t> m_changeStamps;
+
+    uint64_t m_structureVersion = 0;
+    uint64_t m_lastChange = 0;
+};
@@ -5,6 +5,8 @@
 
 #include <stdexcept>
 
+#include "gfx/vk/DeletionQueue.h"
+
 // Mesh::Mesh(const char* modelPath) {
 //     tinyobj::attrib_t attrib;
 //
@@ -50,55 +52,37 @@ Mesh::Mesh(const char* name, const std::vector<Vertex>& vertices, const std::vec
     m_vertices = vertices;
     m_indices = indices;
 
-    m_createVertexBuffer();
-    m_createIndexBuffer();
+    m_range = GeometryArena::get().upload(m_vertices, m_indices);
+
+    // Empty meshes keep empty bounds, there is no first vertex to take the positions from
+    if (m_vertices.empty()) {
+        return;
+    }
+
+    // Sphere around the AABB: not the tightest, but cheap and good enough for culling
+    m_aabb = AABB::fromPoints(&m_vertices.front().pos, m_vertices.size(), sizeof(Vertex));
+    m_boundingSphere = m_aabb.getBoundingSphere();
 }
 
 void Mesh::destroy() const {
-    m_vertexBuffer->destroy();
-    m_indexBuffer->destroy();
+    // In-flight frames may still draw from the range, it is only reused once they complete
+    DeletionQueue::get().retire([range = m_range] { GeometryArena::get().free(range); });
 }
 
-void Mesh::m_createVertexBuffer() {
-    const size_t bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
-    const Buffer stagingBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    m_vertexBuffer =
-        std::make_unique<Buffer>(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    stagingBuffer.setMemory(m_vertices.data());
-    stagingBuffer.copyTo(*m_vertexBuffer);
-    stagingBuffer.destroy();
+Mesh::ID Mesh::getID() const {
+    return m_id;
 }
 
-void Mesh::m_createIndexBuffer() {
-    const size_t bufferSize = sizeof(m_indices[0]) * m_indices.size();
-    const Buffer stagingBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    m_indexBuffer =
-        std::make_unique<Buffer>(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-
-    const VulkanContext& vkContext = VulkanContext::get();
-    void* data;
-    vkMapMemory(vkContext.getDevice(), stagingBuffer.getMemory(), 0, stagingBuffer.getSize(), 0, &data);
-    memcpy(data, m_indices.data(), stagingBuffer.getSize());
-    vkUnmapMemory(vkContext.getDevice(), stagingBuffer.getMemory());
-
-    stagingBuffer.copyTo(*m_indexBuffer);
-    stagingBuffer.destroy();
+const MeshRange& Mesh::getRange() const {
+    return m_range;
 }
 
-const Buffer& Mesh::getVertexBuffer() const {
-    return *m_vertexBuffer;
+const AABB& Mesh::getAABB() const {
+    return m_aabb;
 }
 
-const Buffer& Mesh::getIndexBuffer() const {
-    return *m_indexBuffer;
+const glm::vec4& Mesh::getBoundingSphere() const {
+    return m_boundingSphere;
 }
 
 const std::vector<Vertex>& Mesh::getVertices() const {
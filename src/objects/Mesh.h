@@ -4,11 +4,14 @@
 #include <vector>
 #include <string>
 
-#include "gfx/vk/gpu_resources/Buffer.h"
+#include "common/Bounds.h"
+#include "gfx/vk/gpu_resources/GeometryArena.h"
 #include "gfx/vk/types/Vertex.h"
 
 class Mesh {
 public:
+    typedef uint32_t ID;
+
     // explicit Mesh(const char* modelPath);
 
     Mesh(const char* name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
@@ -17,10 +20,18 @@ public:
     void destroy() const;
 
     [[nodiscard]]
-    const Buffer& getVertexBuffer() const;
+    ID getID() const;
+
+    [[nodiscard]]
+    const MeshRange& getRange() const;
+
+    // Object space
+    [[nodiscard]]
+    const AABB& getAABB() const;
 
+    // Object space center (xyz) and radius (w)
     [[nodiscard]]
-    const Buffer& getIndexBuffer() const;
+    const glm::vec4& getBoundingSphere() const;
 
     [[nodiscard]]
     const std::vector<Vertex>& getVertices() const;
@@ -29,15 +40,21 @@ public:
     const std::vector<uint32_t>& getIndices() const;
 
 private:
+    inline static ID lastID = 0;
+
+    static ID nextID() {
+        return lastID++;
+    }
+
+    const ID m_id = nextID();
+
     std::string m_name;
-    std::unique_ptr<Buffer> m_vertexBuffer;
-    std::unique_ptr<Buffer> m_indexBuffer;
+    MeshRange m_range;
+    AABB m_aabb;
+    glm::vec4 m_boundingSphere{};
 
     std::vector<Vertex> m_vertices;
     std::vector<uint32_t> m_indices;
 
     uint32_t materialId;
-
-    void m_createVertexBuffer();
-    void m_createIndexBuffer();
 };
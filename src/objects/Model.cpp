@@ -123,47 +123,89 @@ using json = nlohmann::json;
 //     fmt::println("Loaded model: {} ({} vertices)", meshPath, m_mesh.getIndices().size());
 // }
 //
-Model::Model(Mesh mesh, const Texture::ID textureID) : m_textureID(textureID) {
+Model::Model(Mesh mesh, const Texture::ID textureID, const MaterialFeatures materialFeatures)
+    : m_textureID(textureID), m_meshFeatures{ materialFeatures } {
     m_meshes.push_back(std::make_shared<Mesh>(std::move(mesh)));
+    m_computeAABB();
 }
 
-Model::Model(const GLTFLoader& loader) : m_textureID(0), m_meshes(loader.meshes) {}
+Model::Model(const GLTFLoader& loader)
+    : m_textureID(0), m_meshes(loader.meshes), m_meshFeatures(loader.meshFeatures) {
+    m_computeAABB();
+}
 
 void Model::destroy() const {
+    if (!m_ownsMeshes) {
+        return;
+    }
+
     for (const auto& mesh : m_meshes) {
         mesh->destroy();
     }
 }
 
+Model Model::instantiate() const {
+    Model instance(*this);
+    instance.m_ownsMeshes = false;
+
+    return instance;
+}
+
 const Texture::ID& Model::getTextureID() const {
     return m_textureID;
 }
 
+MaterialFeatures Model::getMaterialFeatures(const size_t meshIndex) const {
+    return m_meshFeatures[meshIndex];
+}
+
 const std::vector<std::shared_ptr<Mesh>>& Model::getMeshes() const {
     return m_meshes;
 }
 
+const AABB& Model::getAABB() const {
+    return m_aabb;
+}
+
 // const Mesh &Model::getMesh() const {
 //     return m_mesh;
 // }
 
-void Model::draw(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout) const {
-    // for (const auto& mesh : m_meshes) {
-    const std::array buffers = { m_meshes[0]->getVertexBuffer().buffer() };
-    constexpr std::array<VkDeviceSize, buffers.size()> offsets = { 0 };
-
-    vkCmdBindVertexBuffers(commandBuffer, 0, buffers.size(), buffers.data(), offsets.data());
-    vkCmdBindIndexBuffer(commandBuffer, m_meshes[0]->getIndexBuffer().buffer(), 0, VK_INDEX_TYPE_UINT32);
-
-    const glm::mat4 modelMatrix = m_transform.getMatrix();
-    const glm::mat4 normalMatrix = Transform::getNormalMatrix(modelMatrix);
-    const ModelConstants constants{
-        modelMatrix,
-        normalMatrix,
-    };
-
-    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelConstants),
-                       &constants);
-    vkCmdDrawIndexed(commandBuffer, m_meshes[0]->getIndices().size(), 1, 0, 0, 0);
-    // }
+void Model::submit(RenderQueue& queue, LinearAllocator& frameAllocator, const Pipeline& pipeline,
+                   const VkDescriptorSet& materialSet, const RenderQueue::Pass pass,
+                   const glm::vec3& viewPosition) const {
+    // Push constants are read at record time, they live in the frame allocator until then
+    auto* constants = frameAllocator.allocate<ModelConstants>(1);
+    constants->modelMatrix = getWorldMatrix();
+    constants->normalMatrix = getNormalMatrix();
+
+    const GeometryArena& arena = GeometryArena::get();
+    const float depth = glm::distance(viewPosition, m_transform.position);
+
+    for (const auto& mesh : m_meshes) {
+        const MeshRange& range = mesh->getRange();
+
+        RenderItem item{};
+        item.pipeline = &pipeline;
+        item.materialSet = materialSet;
+        item.vertexBuffer = arena.getVertexBuffer().buffer();
+        item.indexBuffer = arena.getIndexBuffer().buffer();
+        item.pushConstants = constants;
+        item.pushConstantsSize = sizeof(ModelConstants);
+        item.indexed = { range.indexCount, 1, range.firstIndex, range.vertexOffset, 0 };
+
+        queue.push(item, { .pass = pass, .material = static_cast<uint32_t>(m_textureID), .mesh = mesh->getID(),
+                           .depth = depth });
+    }
+}
+
+void Model::m_computeAABB() {
+    if (m_meshes.empty()) {
+        return;
+    }
+
+    m_aabb = m_meshes[0]->getAABB();
+    for (const auto& mesh : m_meshes) {
+        m_aabb = m_aabb.merge(mesh->getAABB());
+    }
 }
@@ -2,30 +2,54 @@
 
 #include "Mesh.h"
 #include "common/Thing.h"
+#include "common/LinearAllocator.h"
+#include "gfx/vk/RenderQueue.h"
 #include "gfx/vk/gpu_resources/Texture.h"
+#include "gfx/vk/types/SceneSpecialization.h"
 #include "loaders/GLTFLoader.h"
 
 class Model : public Thing {
 public:
-    Model(Mesh mesh, Texture::ID textureID);
+    Model(Mesh mesh, Texture::ID textureID, MaterialFeatures materialFeatures = MaterialFeature::BaseColorTexture);
     explicit Model(const GLTFLoader& loader);
     // Model(const char* meshPath, Texture::ID textureID);
     // Model(Mesh mesh, Texture::ID textureID);
 
+    // Meshes are only freed by the model they were loaded with, not by its instances
     void destroy() const;
 
+    // Shares this model's meshes, only the transform is per instance.
+    // Models sharing meshes and material are drawn with a single instanced draw.
+    [[nodiscard]]
+    Model instantiate() const;
+
     [[nodiscard]]
     const Texture::ID& getTextureID() const;
 
+    // Selects the scene pipeline permutation of one of getMeshes()
+    [[nodiscard]]
+    MaterialFeatures getMaterialFeatures(size_t meshIndex) const;
+
     [[nodiscard]]
     const std::vector<std::shared_ptr<Mesh>>& getMeshes() const;
 
-    void draw(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout) const;
+    // Object space, encloses every mesh
+    [[nodiscard]]
+    const AABB& getAABB() const;
+
+    // One item per mesh, with the model matrices as push constants
+    void submit(RenderQueue& queue, LinearAllocator& frameAllocator, const Pipeline& pipeline,
+                const VkDescriptorSet& materialSet, RenderQueue::Pass pass, const glm::vec3& viewPosition) const;
 
 private:
     Texture::ID m_textureID;
 
     std::vector<std::shared_ptr<Mesh>> m_meshes;
+    std::vector<MaterialFeatures> m_meshFeatures;  // Parallel to m_meshes
+    AABB m_aabb;
+    bool m_ownsMeshes = true;
     // std::unordered_map<Material> m_materials;
     // std::vector<std::shared_ptr<Material>> m_materials;
+
+    void m_computeAABB();
 };
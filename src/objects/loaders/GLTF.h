@@ -1,5 +1,6 @@
 #pragma once
 
+#include <glm/gtc/quaternion.hpp>
 #include <string>
 #include <variant>
 #include <unordered_map>
@@ -27,6 +28,7 @@ struct Primitive {
 
 struct MetallicRoughness {
     glm::vec4 baseColor{ 1, 1, 1, 1 };
+    bool hasBaseColorTexture = false;
     uint32_t baseColorTexture;
     float metallic = 1.0f;
     float roughness = 1.0f;
@@ -37,10 +39,29 @@ struct Material {
     std::string name;
     MetallicRoughness metallicRoughness;
     uint32_t normalTexture;
+    bool isAlphaMasked = false;  // alphaMode MASK
+    float alphaCutoff = 0.5f;    // Only used when alpha masked
     // uint32_t occlusionTexture;
     // uint32_t emissiveTexture;
 };
 
+// Primitives of a glTF mesh, a range of GLTFLoader::meshes
+struct MeshPrimitives {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// Node of the loaded scene, with a matrix decomposed into TRS
+struct Node {
+    std::string name;
+    int64_t parent = -1;  // Index in GLTFLoader::nodes, parents come before their children
+    int64_t mesh = -1;
+
+    glm::vec3 translation{ 0.0f };
+    glm::quat rotation = glm::identity<glm::quat>();
+    glm::vec3 scale{ 1.0f };
+};
+
 struct DataType {
     enum Type { SCALAR, VEC2, VEC3, VEC4, MAT2, MAT3, MAT4 };
 
@@ -2,6 +2,9 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
 
@@ -10,6 +13,43 @@
 
 using json = nlohmann::json;
 
+namespace {
+// Rotation part of a TRS matrix whose scale was already extracted. A zero scale collapses its axis, which is
+// rebuilt orthogonal to the others: the rotation is then only one of the valid ones, but never NaN.
+glm::mat3 getRotation(const glm::mat3& matrix, const glm::vec3& scale) {
+    constexpr float epsilon = 1e-8f;
+
+    glm::mat3 rotation(1.0f);
+    bool valid[3];
+    uint32_t validCount = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        valid[axis] = std::abs(scale[axis]) > epsilon;
+        if (valid[axis]) {
+            rotation[axis] = matrix[axis] / scale[axis];
+            ++validCount;
+        }
+    }
+
+    if (validCount == 0) {
+        return glm::mat3(1.0f);
+    }
+
+    if (validCount == 1) {
+        // Any axis orthogonal to the remaining one, then the third completes the right handed basis
+        const int axis = valid[0] ? 0 : valid[1] ? 1 : 2;
+        const glm::vec3& kept = rotation[axis];
+        const glm::vec3 helper = std::abs(kept.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        rotation[(axis + 1) % 3] = glm::normalize(glm::cross(kept, helper));
+        rotation[(axis + 2) % 3] = glm::cross(kept, rotation[(axis + 1) % 3]);
+    } else if (validCount == 2) {
+        const int axis = !valid[0] ? 0 : !valid[1] ? 1 : 2;
+        rotation[axis] = glm::cross(rotation[(axis + 1) % 3], rotation[(axis + 2) % 3]);
+    }
+
+    return rotation;
+}
+}  // namespace
+
 GLTFLoader::GLTFLoader(const char* filePath) {
     std::ifstream f(filePath);
     m_gltf = json::parse(f);
@@ -20,42 +60,136 @@ GLTFLoader::GLTFLoader(const char* filePath) {
 
     uint64_t sceneId = m_gltf["scene"];
     for (uint64_t nodeId : m_gltf["scenes"][sceneId]["nodes"]) {
-        auto node = m_gltf["nodes"][nodeId];
-
-        uint64_t meshId = node["mesh"];
-        auto gltfMesh = m_gltf["meshes"][meshId];
-        const std::string meshName = gltfMesh.value("name", "unnamed");
-        for (const auto& primitive : gltfMesh["primitives"]) {
-            const GLTF::Primitive indicesPrimitive = getPrimitiveBuffer(primitive, "indices");
-            const GLTF::Primitive positionsPrimitive = getPrimitiveBuffer(primitive["attributes"], "POSITION");
-            const GLTF::Primitive normalsPrimitive = getPrimitiveBuffer(primitive["attributes"], "NORMAL");
-            const GLTF::Primitive texCoordsPrimitive = getPrimitiveBuffer(primitive["attributes"], "TEXCOORD_0");
-
-            const auto& rawPositions = std::get<std::vector<float>>(positionsPrimitive.data);
-            const auto& rawNormals = std::get<std::vector<float>>(normalsPrimitive.data);
-            const auto& rawTexCoords = std::get<std::vector<float>>(texCoordsPrimitive.data);
-
-            std::vector<Vertex> vertices(positionsPrimitive.count);
-            for (int i = 0; i < positionsPrimitive.count; ++i) {
-                vertices[i].pos = glm::make_vec3(&rawPositions[i * 3]);
-                vertices[i].normal = glm::make_vec3(&rawNormals[i * 3]);
-                vertices[i].texCoord = glm::make_vec2(&rawTexCoords[i * 2]);
-                vertices[i].color = { 1, 1, 1 }; // TODO: is this ok?
-            }
+        loadNode(nodeId, -1);
+    }
+
+    // Nodes may share a mesh, it is loaded once and instanced by each of them
+    meshPrimitives.resize(m_gltf.contains("meshes") ? m_gltf["meshes"].size() : 0);
+    for (const GLTF::Node& node : nodes) {
+        if (node.mesh >= 0 && meshPrimitives[node.mesh].count == 0) {
+            loadMesh(node.mesh);
+        }
+    }
+}
+
+std::vector<SceneGraph::NodeID> GLTFLoader::addToSceneGraph(SceneGraph& graph, const SceneGraph::NodeID parent) const {
+    std::vector<SceneGraph::NodeID> graphNodes;
+    graphNodes.reserve(nodes.size());
+
+    for (const GLTF::Node& node : nodes) {
+        const SceneGraph::NodeID nodeParent = node.parent < 0 ? parent : graphNodes[node.parent];
+        graphNodes.push_back(graph.addNode(nodeParent, { node.translation, node.rotation, node.scale }));
+    }
+
+    return graphNodes;
+}
+
+void GLTFLoader::loadMesh(const uint64_t meshId) {
+    const json& gltfMesh = m_gltf["meshes"][meshId];
+    const std::string meshName = gltfMesh.value("name", "unnamed");
+
+    GLTF::MeshPrimitives& primitives = meshPrimitives[meshId];
+    primitives.first = meshes.size();
+
+    for (const auto& primitive : gltfMesh["primitives"]) {
+        MaterialFeatures materialFeatures = 0;
+
+        const GLTF::Primitive indicesPrimitive = getPrimitiveBuffer(primitive, "indices");
+        const GLTF::Primitive positionsPrimitive = getPrimitiveBuffer(primitive["attributes"], "POSITION");
+        const GLTF::Primitive normalsPrimitive = getPrimitiveBuffer(primitive["attributes"], "NORMAL");
+        const GLTF::Primitive texCoordsPrimitive = getPrimitiveBuffer(primitive["attributes"], "TEXCOORD_0");
 
-            const auto& rawIndices = std::get<std::vector<uint16_t>>(indicesPrimitive.data);
-            std::vector<uint32_t> indices(indicesPrimitive.count);
-            for (int i = 0; i < indicesPrimitive.count; ++i) {
-                indices[i] = rawIndices[i];
+        const auto& rawPositions = std::get<std::vector<float>>(positionsPrimitive.data);
+        const auto& rawNormals = std::get<std::vector<float>>(normalsPrimitive.data);
+        const auto& rawTexCoords = std::get<std::vector<float>>(texCoordsPrimitive.data);
+
+        std::vector<Vertex> vertices(positionsPrimitive.count);
+        for (int i = 0; i < positionsPrimitive.count; ++i) {
+            vertices[i].pos = glm::make_vec3(&rawPositions[i * 3]);
+            vertices[i].normal = glm::make_vec3(&rawNormals[i * 3]);
+            vertices[i].texCoord = glm::make_vec2(&rawTexCoords[i * 2]);
+            vertices[i].color = { 1, 1, 1 }; // TODO: is this ok?
+        }
+
+        // Only float colors for now, normalized integer ones keep the default white
+        if (primitive["attributes"].contains("COLOR_0")) {
+            const GLTF::Primitive colorsPrimitive = getPrimitiveBuffer(primitive["attributes"], "COLOR_0");
+            if (const auto* rawColors = std::get_if<std::vector<float>>(&colorsPrimitive.data)) {
+                const uint64_t componentCount = rawColors->size() / colorsPrimitive.count;
+                for (int i = 0; i < colorsPrimitive.count; ++i) {
+                    vertices[i].color = glm::make_vec3(&(*rawColors)[i * componentCount]);
+                }
+
+                materialFeatures |= MaterialFeature::VertexColor;
             }
+        }
+
+        // Indices are unsigned bytes, shorts or ints depending on the mesh size
+        std::vector<uint32_t> indices(indicesPrimitive.count);
+        std::visit(
+            [&indices](const auto& rawIndices) {
+                for (size_t i = 0; i < indices.size(); ++i) {
+                    indices[i] = static_cast<uint32_t>(rawIndices[i]);
+                }
+            },
+            indicesPrimitive.data);
+
+        meshes.emplace_back(std::make_shared<Mesh>(meshName.c_str(), vertices, indices));
+
+        const GLTF::Material gltfMaterial = getMaterial(primitive["material"]);
+        if (gltfMaterial.metallicRoughness.hasBaseColorTexture) {
+            materialFeatures |= MaterialFeature::BaseColorTexture;
+        }
+
+        if (gltfMaterial.isAlphaMasked) {
+            materialFeatures = withAlphaCutoff(materialFeatures | MaterialFeature::AlphaMask, gltfMaterial.alphaCutoff);
+        }
+
+        meshFeatures.push_back(materialFeatures);
+        ++primitives.count;
+    }
+}
 
-            auto mesh = std::make_shared<Mesh>("", vertices, indices);
-            meshes.emplace_back(mesh);
+void GLTFLoader::loadNode(const uint64_t nodeId, const int64_t parent) {
+    const json& gltfNode = m_gltf["nodes"][nodeId];
 
-            const GLTF::Material gltfMaterial = getMaterial(primitive["material"]);
-            Material material(gltfMaterial.name);
+    GLTF::Node node{ .name = gltfNode.value("name", "unnamed"), .parent = parent };
+    if (gltfNode.contains("mesh")) {
+        node.mesh = gltfNode["mesh"];
+    }
+
+    if (gltfNode.contains("matrix")) {
+        // Column major like glm. glTF matrices are decomposable, without skew
+        const glm::mat4 matrix = glm::make_mat4(gltfNode["matrix"].get<std::vector<float>>().data());
+        node.translation = glm::vec3(matrix[3]);
+        node.scale = { glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])),
+                       glm::length(glm::vec3(matrix[2])) };
+        if (glm::determinant(glm::mat3(matrix)) < 0.0f) {
+            node.scale.x = -node.scale.x;
+        }
+
+        node.rotation = glm::quat_cast(getRotation(glm::mat3(matrix), node.scale));
+    } else {
+        if (gltfNode.contains("translation")) {
+            node.translation = glm::make_vec3(gltfNode["translation"].get<std::vector<float>>().data());
+        }
+
+        if (gltfNode.contains("rotation")) {
+            const std::vector<float> rotation = gltfNode["rotation"].get<std::vector<float>>();
+            node.rotation = glm::quat(rotation[3], rotation[0], rotation[1], rotation[2]);  // glTF is xyzw
+        }
+
+        if (gltfNode.contains("scale")) {
+            node.scale = glm::make_vec3(gltfNode["scale"].get<std::vector<float>>().data());
+        }
+    }
+
+    const int64_t index = nodes.size();
+    nodes.push_back(std::move(node));
 
-            return; // TODO: more meshes
+    if (gltfNode.contains("children")) {
+        for (const uint64_t childId : gltfNode["children"]) {
+            loadNode(childId, index);
         }
     }
 }
@@ -159,6 +293,7 @@ GLTF::Material GLTFLoader::getMaterial(uint64_t materialId) {
 
         j = pbrMaterial["baseColorTexture"];
         if (j != nullptr) {
+            material.metallicRoughness.hasBaseColorTexture = true;
             material.metallicRoughness.baseColorTexture = j["index"];
         } else {
             fmt::println("warning: baseColorTexture was not defined for material {}", materialId);
@@ -180,6 +315,9 @@ GLTF::Material GLTFLoader::getMaterial(uint64_t materialId) {
         material.normalTexture = normal["index"];
     }
 
+    material.isAlphaMasked = rawMaterial.value("alphaMode", "OPAQUE") == "MASK";
+    material.alphaCutoff = rawMaterial.value("alphaCutoff", 0.5f);
+
     return material;
 }
 
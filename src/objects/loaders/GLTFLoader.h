@@ -6,6 +6,8 @@
 #include <vector>
 
 #include "GLTF.h"
+#include "common/SceneGraph.h"
+#include "gfx/vk/types/SceneSpecialization.h"
 #include "objects/Mesh.h"
 
 class GLTFLoader {
@@ -17,11 +19,26 @@ class GLTFLoader {
 public:
     explicit GLTFLoader(const char* filePath);
 
+    // One per primitive of every mesh used by the default scene, each glTF mesh is loaded once
     std::vector<std::shared_ptr<Mesh>> meshes;
+    std::vector<MaterialFeatures> meshFeatures;  // Parallel to meshes
+
+    // Indexed by glTF mesh, unused meshes have no primitives
+    std::vector<GLTF::MeshPrimitives> meshPrimitives;
+
+    // Hierarchy of the default scene
+    std::vector<GLTF::Node> nodes;
+
+    // Adds every node under `parent`, returns their IDs indexed like nodes
+    [[nodiscard]]
+    std::vector<SceneGraph::NodeID> addToSceneGraph(SceneGraph& graph,
+                                                    SceneGraph::NodeID parent = SceneGraph::noParent) const;
     // std::vector<std::shared_ptr<Materials>> materials;
 
 private:
     void loadFiles(const std::filesystem::path& rootPath);
+    void loadNode(uint64_t nodeId, int64_t parent);
+    void loadMesh(uint64_t meshId);
     GLTF::Primitive getPrimitiveBuffer(const nlohmann::json& primitive, const char* key);
     GLTF::Material getMaterial(uint64_t materialId);
     // void loadVertices();
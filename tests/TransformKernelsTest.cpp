@@ -0,0 +1,168 @@
+// Checks every supported TransformKernels path against Transform::getMatrix() / getNormalMatrix().
+// Exits with a non zero status on the first mismatching run.
+
+#include <fmt/base.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "common/Transform.h"
+#include "common/TransformKernels.h"
+
+using TransformKernels::InstructionSet;
+
+namespace {
+// Relative to the largest element of the expected matrix: positions go up to 100, inverse scales to 10
+constexpr float tolerance = 1e-5f;
+
+// Counts around the 4 and 8 wide blocks, so that every tail length is covered
+constexpr std::array testCounts = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 15, 16, 17, 23, 31, 32, 33, 1000 };
+
+// Starts off a SIMD alignment, as a run of scene graph slots would
+constexpr size_t firstOffset = 1;
+
+struct Inputs {
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    [[nodiscard]]
+    TransformKernels::TransformArrays getArrays(const size_t first) const {
+        return {
+            .positionX = positionX.data() + first,
+            .positionY = positionY.data() + first,
+            .positionZ = positionZ.data() + first,
+            .rotationX = rotationX.data() + first,
+            .rotationY = rotationY.data() + first,
+            .rotationZ = rotationZ.data() + first,
+            .rotationW = rotationW.data() + first,
+            .scaleX = scaleX.data() + first,
+            .scaleY = scaleY.data() + first,
+            .scaleZ = scaleZ.data() + first,
+        };
+    }
+
+    [[nodiscard]]
+    Transform getTransform(const size_t i) const {
+        return {
+            { positionX[i], positionY[i], positionZ[i] },
+            { rotationW[i], rotationX[i], rotationY[i], rotationZ[i] },
+            { scaleX[i], scaleY[i], scaleZ[i] },
+        };
+    }
+};
+
+Inputs makeInputs(const size_t count, std::mt19937& random) {
+    std::uniform_real_distribution position(-100.0f, 100.0f);
+    std::uniform_real_distribution unit(-1.0f, 1.0f);
+    std::uniform_real_distribution scale(0.1f, 4.0f);
+    std::bernoulli_distribution mirrored(0.2);
+
+    Inputs inputs;
+    for (size_t i = 0; i < count; ++i) {
+        inputs.positionX.push_back(position(random));
+        inputs.positionY.push_back(position(random));
+        inputs.positionZ.push_back(position(random));
+
+        const glm::quat rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+        inputs.rotationX.push_back(rotation.x);
+        inputs.rotationY.push_back(rotation.y);
+        inputs.rotationZ.push_back(rotation.z);
+        inputs.rotationW.push_back(rotation.w);
+
+        // Negative scales (mirrored glTF nodes) included
+        inputs.scaleX.push_back(scale(random) * (mirrored(random) ? -1.0f : 1.0f));
+        inputs.scaleY.push_back(scale(random) * (mirrored(random) ? -1.0f : 1.0f));
+        inputs.scaleZ.push_back(scale(random) * (mirrored(random) ? -1.0f : 1.0f));
+    }
+
+    return inputs;
+}
+
+bool matches(const glm::mat4& expected, const glm::mat4& actual) {
+    float magnitude = 1.0f;
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            magnitude = std::max(magnitude, std::abs(expected[column][row]));
+        }
+    }
+
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            if (std::abs(expected[column][row] - actual[column][row]) > tolerance * magnitude) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool testRun(const InstructionSet instructionSet, const size_t count, const bool withNormals, std::mt19937& random) {
+    const Inputs inputs = makeInputs(firstOffset + count, random);
+
+    // One extra matrix past the end, which must not be written
+    const glm::mat4 sentinel(-42.0f);
+    std::vector worldMatrices(count + 1, sentinel);
+    std::vector normalMatrices(count + 1, sentinel);
+
+    TransformKernels::computeMatrices(inputs.getArrays(firstOffset), count, worldMatrices.data(),
+                                      withNormals ? normalMatrices.data() : nullptr, instructionSet);
+
+    const char* name = TransformKernels::getInstructionSetName(instructionSet);
+    for (size_t i = 0; i < count; ++i) {
+        const Transform transform = inputs.getTransform(firstOffset + i);
+        const glm::mat4 expectedWorld = transform.getMatrix();
+        if (!matches(expectedWorld, worldMatrices[i])) {
+            fmt::println("FAIL {}: world matrix {} of {} differs", name, i, count);
+            return false;
+        }
+
+        if (withNormals && !matches(Transform::getNormalMatrix(expectedWorld), normalMatrices[i])) {
+            fmt::println("FAIL {}: normal matrix {} of {} differs", name, i, count);
+            return false;
+        }
+    }
+
+    if (worldMatrices[count] != sentinel || normalMatrices[count] != sentinel) {
+        fmt::println("FAIL {}: wrote past the end of {} matrices", name, count);
+        return false;
+    }
+    if (!withNormals && count > 0 && normalMatrices[0] != sentinel) {
+        fmt::println("FAIL {}: wrote normal matrices while none were requested", name);
+        return false;
+    }
+
+    return true;
+}
+}  // namespace
+
+int main() {
+    std::mt19937 random(1234);
+
+    const InstructionSet widest = TransformKernels::getInstructionSet();
+    fmt::println("Widest supported instruction set: {}", TransformKernels::getInstructionSetName(widest));
+
+    for (const InstructionSet instructionSet : { InstructionSet::Scalar, InstructionSet::SSE, InstructionSet::AVX2 }) {
+        const char* name = TransformKernels::getInstructionSetName(instructionSet);
+        if (instructionSet > widest) {
+            fmt::println("SKIP {}: not supported by this CPU", name);
+            continue;
+        }
+
+        for (const size_t count : testCounts) {
+            for (const bool withNormals : { true, false }) {
+                if (!testRun(instructionSet, count, withNormals, random)) {
+                    return 1;
+                }
+            }
+        }
+
+        fmt::println("PASS {}", name);
+    }
+
+    return 0;
+}